@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAX_BENCHES 64
+#define MAX_SAMPLES 64
+#define MAX_NAME_LEN 64
+
+#define DEFAULT_THRESHOLD_PERCENT 5.0
+#define SIGNIFICANCE_LEVEL 0.05
+
+#define BETACF_MAX_ITERATIONS 200
+#define BETACF_EPSILON 3e-12
+#define BETACF_MIN 1e-300
+
+struct bench_samples {
+    char name[MAX_NAME_LEN];
+    double samples[MAX_SAMPLES];
+    int n;
+};
+
+struct bench_file {
+    struct bench_samples benches[MAX_BENCHES];
+    int n;
+};
+
+// Read the benchmark names and samples from a `bench-results.json` file.
+int read_results(const char *path, struct bench_file *results) {
+    FILE *f;
+    long len;
+    char *buffer;
+    char *p;
+    char *end;
+    struct bench_samples *b;
+
+    f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "bench-compare: Failed to open '%s'\n", path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    buffer = calloc(len + 1, 1);
+    if (!buffer || fread(buffer, 1, len, f) != (size_t) len) {
+        fprintf(stderr, "bench-compare: Failed to read '%s'\n", path);
+        free(buffer);
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+
+    results->n = 0;
+    p = buffer;
+    while ((p = strstr(p, "\"name\": \"")) && results->n < MAX_BENCHES) {
+        b = &results->benches[results->n++];
+        p += strlen("\"name\": \"");
+        end = strchr(p, '"');
+        if (!end) {
+            break;
+        }
+        snprintf(b->name, MAX_NAME_LEN, "%.*s", (int) (end - p), p);
+
+        p = strstr(end, "\"samples_ns\": [");
+        if (!p) {
+            break;
+        }
+        p += strlen("\"samples_ns\": [");
+        b->n = 0;
+        while (*p != ']' && b->n < MAX_SAMPLES) {
+            b->samples[b->n++] = strtod(p, &end);
+            if (end == p) {
+                break;
+            }
+            p = end + strspn(end, ", ");
+        }
+    }
+    free(buffer);
+    return 0;
+}
+
+double mean(const double *samples, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    return sum / n;
+}
+
+double variance(const double *samples, int n) {
+    double m = mean(samples, n);
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (samples[i] - m) * (samples[i] - m);
+    }
+    return sum / (n - 1);
+}
+
+// Continued fraction for the incomplete beta function (modified Lentz's method).
+double betacf(double a, double b, double x) {
+    double c = 1;
+    double d = 1 - (a + b) * x / (a + 1);
+    double h;
+    double aa;
+    double delta;
+
+    d = fabs(d) < BETACF_MIN ? BETACF_MIN : d;
+    d = 1 / d;
+    h = d;
+    for (int m = 1; m <= BETACF_MAX_ITERATIONS; m++) {
+        // Even step
+        aa = m * (b - m) * x / ((a + 2 * m - 1) * (a + 2 * m));
+        d = 1 + aa * d;
+        d = fabs(d) < BETACF_MIN ? BETACF_MIN : d;
+        c = 1 + aa / c;
+        c = fabs(c) < BETACF_MIN ? BETACF_MIN : c;
+        d = 1 / d;
+        h *= d * c;
+        // Odd step
+        aa = -(a + m) * (a + b + m) * x / ((a + 2 * m) * (a + 2 * m + 1));
+        d = 1 + aa * d;
+        d = fabs(d) < BETACF_MIN ? BETACF_MIN : d;
+        c = 1 + aa / c;
+        c = fabs(c) < BETACF_MIN ? BETACF_MIN : c;
+        d = 1 / d;
+        delta = d * c;
+        h *= delta;
+        if (fabs(delta - 1) < BETACF_EPSILON) {
+            break;
+        }
+    }
+    return h;
+}
+
+// Regularised incomplete beta function I_x(a, b).
+double incomplete_beta(double a, double b, double x) {
+    double front;
+
+    if (x <= 0) {
+        return 0;
+    }
+    if (x >= 1) {
+        return 1;
+    }
+    front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1 - x));
+    if (x < (a + 1) / (a + b + 2)) {
+        return front * betacf(a, b, x) / a;
+    }
+    return 1 - front * betacf(b, a, 1 - x) / b;
+}
+
+/*
+ * Two-sided p-value of Welch's t-test, i.e. the probability of seeing a
+ * difference in means at least this large from run-to-run noise alone.
+ */
+double welch_p_value(const struct bench_samples *a, const struct bench_samples *b) {
+    double va = variance(a->samples, a->n) / a->n;
+    double vb = variance(b->samples, b->n) / b->n;
+    double t;
+    double df;
+
+    if (va + vb == 0) {
+        return mean(a->samples, a->n) == mean(b->samples, b->n) ? 1 : 0;
+    }
+    t = (mean(b->samples, b->n) - mean(a->samples, a->n)) / sqrt(va + vb);
+    df = (va + vb) * (va + vb) / (va * va / (a->n - 1) + vb * vb / (b->n - 1));
+    return incomplete_beta(df / 2, 0.5, df / (df + t * t));
+}
+
+int main(int argc, char *argv[]) {
+    static struct bench_file baseline;
+    static struct bench_file current;
+    struct bench_samples *base;
+    struct bench_samples *cur;
+    double threshold = DEFAULT_THRESHOLD_PERCENT;
+    double base_mean;
+    double cur_mean;
+    double change;
+    double p;
+    const char *status;
+    int regressions = 0;
+
+    if (argc < 3 || argc > 4) {
+        printf("Usage: %s baseline.json results.json [threshold %%]\n", argv[0]);
+        return -1;
+    }
+    if (argc == 4) {
+        threshold = atof(argv[3]);
+    }
+    if (read_results(argv[1], &baseline) != 0) {
+        fprintf(stderr, "bench-compare: No baseline, create one with `make bench-baseline`\n");
+        return -1;
+    }
+    if (read_results(argv[2], &current) != 0) {
+        return -1;
+    }
+
+    printf("* Compared to '%s' (regression: > %.1f%% slower, p < %.2f)\n",
+        argv[1], threshold, SIGNIFICANCE_LEVEL);
+    printf("%-20s %12s %12s %9s %8s  %s\n", "benchmark", "base ns/op", "ns/op", "change", "p", "status");
+    for (int i = 0; i < current.n; i++) {
+        cur = &current.benches[i];
+        base = NULL;
+        for (int j = 0; j < baseline.n; j++) {
+            if (strcmp(baseline.benches[j].name, cur->name) == 0) {
+                base = &baseline.benches[j];
+            }
+        }
+        if (!base || base->n < 2 || cur->n < 2) {
+            printf("%-20s %12s %12s %9s %8s  %s\n", cur->name, "-", "-", "-", "-", "skipped");
+            continue;
+        }
+
+        base_mean = mean(base->samples, base->n);
+        cur_mean = mean(cur->samples, cur->n);
+        if (base_mean == 0 || cur_mean == 0) {
+            printf("%-20s %12s %12s %9s %8s  %s\n", cur->name, "-", "-", "-", "-", "skipped");
+            continue;
+        }
+        change = 100.0 * (cur_mean - base_mean) / base_mean;
+        p = welch_p_value(base, cur);
+
+        // Only a change that is both large and unlikely to be noise counts
+        if (p >= SIGNIFICANCE_LEVEL || fabs(change) <= threshold) {
+            status = "ok";
+        } else if (change > 0) {
+            status = "REGRESSION";
+            regressions++;
+        } else {
+            status = "improved";
+        }
+        printf("%-20s %12.2f %12.2f %+8.1f%% %8.4f  %s\n", cur->name, base_mean, cur_mean, change, p, status);
+    }
+
+    if (regressions) {
+        printf("\n%d benchmark(s) regressed\n", regressions);
+        return 1;
+    }
+    printf("\nNo regressions\n");
+    return 0;
+}
@@ -0,0 +1,337 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+// Saved and loaded by `bench_state_save_load`, rather than the user's save state
+#define CHIP8_STATE_FILE_NAME "bench-state.bin"
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+#include "../src/peripheral.c"
+#include "../src/pixel.c"
+#include "../src/audio.c"
+#include "../src/trace.c"
+
+#ifndef BENCH_BUILD
+#define BENCH_BUILD "unknown"
+#endif
+
+#define DEFAULT_REPEATS 5
+#define MAX_REPEATS 64
+#define DEFAULT_RESULTS_FILE "bench-results.json"
+
+#define INTERP_OPS 2000000
+#define DXYN_OPS 200000
+#define SCROLL_OPS 20000
+#define DRAW_STEP_OPS 200
+#define HASH_OPS 20000
+#define STATE_OPS 200
+#define SNAPSHOT_OPS 20000
+
+#define SYNTHETIC_ROM_DIR "bench/roms/"
+#define BENCH_TRACE_FILE_NAME "bench-trace.bin"
+
+struct bench {
+    const char *name;
+    double (*run)(const char *, uint32_t);  // returns nanoseconds per op of one run
+    const char *rom_path;
+    uint32_t ops;
+    double samples[MAX_REPEATS];
+};
+
+uint8_t sdl_available;
+
+double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// One op = one instruction of the ROM at `rom_path`
+double bench_interp(const char *rom_path, uint32_t ops) {
+    double start;
+
+    chip8_init();
+    chip8_load_rom(rom_path);
+    start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        chip8_step(0, 0.0);
+    }
+    return (now_ns() - start) / ops;
+}
+
+// As `bench_interp`, with every instruction traced to file
+double bench_interp_trace(const char *rom_path, uint32_t ops) {
+    double start;
+
+    chip8_init();
+    chip8_load_rom(rom_path);
+    start = now_ns();
+    trace_open(BENCH_TRACE_FILE_NAME);
+    chip8_trace_hook = &trace_record;
+    for (uint32_t i = 0; i < ops; i++) {
+        chip8_step(0, 0.0);
+    }
+    trace_close();
+    chip8_trace_hook = NULL;
+    return (now_ns() - start) / ops;
+}
+
+// Encode only, reusing the buffer once full: the emulation thread's share of
+// tracing, i.e. the overhead when the writer thread has a core of its own
+void bench_trace_encode(const struct chip8_trace_record *record) {
+    trace_encode(record);
+    if (trace_current->len > TRACE_BUFFER_SIZE - TRACE_MAX_RECORD_SIZE) {
+        trace_current->len = 0;
+    }
+}
+
+// As `bench_interp_trace`, without the writer thread or file
+double bench_interp_trace_encode(const char *rom_path, uint32_t ops) {
+    double start;
+
+    chip8_init();
+    chip8_load_rom(rom_path);
+    start = now_ns();
+    trace_encoder_init();
+    chip8_trace_hook = &bench_trace_encode;
+    for (uint32_t i = 0; i < ops; i++) {
+        chip8_step(0, 0.0);
+    }
+    chip8_trace_hook = NULL;
+    return (now_ns() - start) / ops;
+}
+
+double run_dxyn(uint8_t low_res, uint16_t instruction, uint32_t ops) {
+    double start;
+
+    chip8_init();
+    low_res_mode = low_res;
+    I = SFONT_START_ADDR;
+    start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        V[0x0] = i * 3;
+        V[0x1] = i * 5;
+        decode_and_exec(instruction, 0);
+    }
+    return (now_ns() - start) / ops;
+}
+
+double bench_dxyn_low_res(const char *unused, uint32_t ops) {
+    (void) unused;
+    return run_dxyn(1, 0xD01A, ops);  // 8x10 sprite
+}
+
+double bench_dxyn_high_res(const char *unused, uint32_t ops) {
+    (void) unused;
+    return run_dxyn(0, 0xD01A, ops);
+}
+
+double bench_dxy0_low_res(const char *unused, uint32_t ops) {
+    (void) unused;
+    return run_dxyn(1, 0xD010, ops);  // 16x16 sprite
+}
+
+double bench_dxy0_high_res(const char *unused, uint32_t ops) {
+    (void) unused;
+    return run_dxyn(0, 0xD010, ops);
+}
+
+double bench_scroll(const char *unused, uint32_t ops) {
+    uint16_t scrolls[] = {0x00C4, 0x00FB, 0x00FC};
+    double start;
+
+    (void) unused;
+    chip8_init();
+    low_res_mode = 0;
+    for (int i = 0; i < DISPLAY_RES_X * DISPLAY_RES_Y; i += 3) {
+        chip8_display[i] = 1;
+    }
+    start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        decode_and_exec(scrolls[i % 3], 0);
+    }
+    return (now_ns() - start) / ops;
+}
+
+double bench_sdl_draw_step(const char *unused, uint32_t ops) {
+    double start;
+
+    (void) unused;
+    if (!sdl_available) {
+        return 0;
+    }
+    chip8_init();
+    for (int i = 0; i < DISPLAY_RES_X * DISPLAY_RES_Y; i += 7) {
+        chip8_display[i] = 1;
+    }
+    start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        chip8_display[i] ^= 1;
+        sdl_draw_step(chip8_display);
+    }
+    return (now_ns() - start) / ops;
+}
+
+double bench_display_hash(const char *unused, uint32_t ops) {
+    volatile uint64_t hash;
+    double start;
+
+    (void) unused;
+    chip8_init();
+    start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        chip8_display[i % (DISPLAY_RES_X * DISPLAY_RES_Y)] ^= 1;
+        hash = chip8_display_hash(chip8_display);
+    }
+    (void) hash;
+    return (now_ns() - start) / ops;
+}
+
+// One op = a state written to and loaded back from file
+double bench_state_save_load(const char *rom_path, uint32_t ops) {
+    double start;
+
+    chip8_init();
+    chip8_load_rom(rom_path);
+    start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        chip8_write_state();
+        chip8_load_state();
+    }
+    return (now_ns() - start) / ops;
+}
+
+// One op = an in memory snapshot and restore
+double bench_state_snapshot(const char *rom_path, uint32_t ops) {
+    uint8_t buffer[CHIP8_SNAPSHOT_SIZE];
+    double start;
+
+    chip8_init();
+    chip8_load_rom(rom_path);
+    start = now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        chip8_snapshot(buffer);
+        chip8_restore(buffer);
+    }
+    return (now_ns() - start) / ops;
+}
+
+struct bench benches[] = {
+    {"interp_ibm",          bench_interp,          "roms/IBM.ch8",                     INTERP_OPS,      {0}},
+    {"interp_test_opcode",  bench_interp,          "roms/test_opcode.ch8",             INTERP_OPS,      {0}},
+    {"interp_alu",          bench_interp,          SYNTHETIC_ROM_DIR "alu.ch8",        INTERP_OPS,      {0}},
+    {"interp_draw",         bench_interp,          SYNTHETIC_ROM_DIR "draw.ch8",       INTERP_OPS,      {0}},
+    {"interp_hires16",      bench_interp,          SYNTHETIC_ROM_DIR "hires16.ch8",    INTERP_OPS,      {0}},
+    {"interp_scroll",       bench_interp,          SYNTHETIC_ROM_DIR "scroll.ch8",     SCROLL_OPS,      {0}},
+    {"interp_mem",          bench_interp,          SYNTHETIC_ROM_DIR "mem.ch8",        INTERP_OPS,      {0}},
+    {"interp_call",         bench_interp,          SYNTHETIC_ROM_DIR "call.ch8",       INTERP_OPS,      {0}},
+    {"interp_trace",        bench_interp_trace,    "roms/test_opcode.ch8",             INTERP_OPS,      {0}},
+    {"interp_trace_encode", bench_interp_trace_encode, "roms/test_opcode.ch8",         INTERP_OPS,      {0}},
+    {"dxyn_low_res",        bench_dxyn_low_res,    NULL,                               DXYN_OPS,        {0}},
+    {"dxyn_high_res",       bench_dxyn_high_res,   NULL,                               DXYN_OPS,        {0}},
+    {"dxy0_low_res",        bench_dxy0_low_res,    NULL,                               DXYN_OPS,        {0}},
+    {"dxy0_high_res",       bench_dxy0_high_res,   NULL,                               DXYN_OPS,        {0}},
+    {"scroll",              bench_scroll,          NULL,                               SCROLL_OPS,      {0}},
+    {"sdl_draw_step",       bench_sdl_draw_step,   NULL,                               DRAW_STEP_OPS,   {0}},
+    {"display_hash",        bench_display_hash,    NULL,                               HASH_OPS,        {0}},
+    {"state_save_load",     bench_state_save_load, "roms/test_opcode.ch8",             STATE_OPS,       {0}},
+    {"state_snapshot",      bench_state_snapshot,  "roms/test_opcode.ch8",             SNAPSHOT_OPS,    {0}}
+};
+
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+double mean(const double *samples, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += samples[i];
+    }
+    return sum / n;
+}
+
+// Sample standard deviation
+double stddev(const double *samples, int n) {
+    double m = mean(samples, n);
+    double sum = 0;
+
+    if (n < 2) {
+        return 0;
+    }
+    for (int i = 0; i < n; i++) {
+        sum += (samples[i] - m) * (samples[i] - m);
+    }
+    return sqrt(sum / (n - 1));
+}
+
+void write_results(const char *path, int repeats) {
+    FILE *f;
+    struct bench *b;
+
+    f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "bench: Failed to open '%s'\n", path);
+        return;
+    }
+    fprintf(f, "{\n  \"build\": \"%s\",\n  \"repeats\": %d,\n  \"benchmarks\": [", BENCH_BUILD, repeats);
+    for (unsigned long i = 0; i < NUM_BENCHES; i++) {
+        b = &benches[i];
+        fprintf(f, "%s\n    {\"name\": \"%s\", \"ops\": %u, \"mean_ns\": %.3f, \"stddev_ns\": %.3f, \"samples_ns\": [",
+            i ? "," : "", b->name, b->ops, mean(b->samples, repeats), stddev(b->samples, repeats));
+        for (int r = 0; r < repeats; r++) {
+            fprintf(f, "%s%.3f", r ? ", " : "", b->samples[r]);
+        }
+        fprintf(f, "]}");
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}
+
+int main(int argc, char *argv[]) {
+    const char *results_path = DEFAULT_RESULTS_FILE;
+    int repeats = DEFAULT_REPEATS;
+    struct bench *b;
+    double m;
+
+    if (argc > 1) {
+        repeats = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        results_path = argv[2];
+    }
+    if (repeats < 1 || repeats > MAX_REPEATS) {
+        printf("Usage: %s [1..%d] (repeats) [results_path]\n", argv[0], MAX_REPEATS);
+        return -1;
+    }
+
+    // Headless rendering for `sdl_draw_step`
+    SDL_setenv("SDL_VIDEODRIVER", "dummy", 0);
+    SDL_setenv("SDL_AUDIODRIVER", "dummy", 0);
+    sdl_available = sdl_init(1, VIDEO_DOUBLE_BUFFER) == 0;
+    if (!sdl_available) {
+        printf("[INFO] bench: SDL unavailable, skipping sdl_draw_step\n");
+    }
+
+    printf("* Build: %s, %d repeats\n", BENCH_BUILD, repeats);
+    printf("%-20s %12s %10s %10s\n", "benchmark", "ns/op", "stddev", "Mops/s");
+    for (unsigned long i = 0; i < NUM_BENCHES; i++) {
+        b = &benches[i];
+        for (int r = 0; r < repeats; r++) {
+            b->samples[r] = b->run(b->rom_path, b->ops);
+        }
+        m = mean(b->samples, repeats);
+        printf("%-20s %12.2f %10.2f %10.2f\n", b->name, m, stddev(b->samples, repeats),
+            m > 0 ? 1000.0 / m : 0);
+    }
+
+    write_results(results_path, repeats);
+    printf("\nResults written to '%s'\n", results_path);
+
+    if (sdl_available) {
+        sdl_close();
+    }
+    remove(CHIP8_STATE_FILE_NAME);
+    remove(BENCH_TRACE_FILE_NAME);
+    return 0;
+}
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Generates synthetic ROMs with controlled instruction mixes, so each
+ * benchmark exercises one part of the interpreter.
+ * 
+ * Usage: ch8-romgen out_dir
+ * Writes out_dir/<name>.ch8 for each ROM below.
+ */
+
+#define PROG_START_ADDR 0x200
+#define MAX_ROM_SIZE (0x1000 - PROG_START_ADDR)
+#define MAX_PATH_LEN 256
+
+// Subroutine depth of the call ROM, stack size - 1 for the top level call
+#define CALL_DEPTH 15
+#define CALL_SUB_ADDR 0x300
+
+struct rom {
+    uint8_t data[MAX_ROM_SIZE];
+    uint16_t len;
+};
+
+// Append an instruction, returns its address
+uint16_t emit(struct rom *rom, uint16_t instruction) {
+    uint16_t addr = PROG_START_ADDR + rom->len;
+    rom->data[rom->len++] = instruction >> 8;
+    rom->data[rom->len++] = instruction & 0xFF;
+    return addr;
+}
+
+// Address of the next emitted instruction
+uint16_t here(struct rom *rom) {
+    return PROG_START_ADDR + rom->len;
+}
+
+// ALU heavy: 8XYN arithmetic and logic in a tight loop
+void gen_alu(struct rom *rom) {
+    uint16_t loop;
+
+    emit(rom, 0x6001);  // V0 = 1
+    emit(rom, 0x6103);  // V1 = 3
+    emit(rom, 0x6207);  // V2 = 7
+    loop = here(rom);
+    emit(rom, 0x8014);  // V0 += V1
+    emit(rom, 0x8125);  // V1 -= V2
+    emit(rom, 0x8206);  // V2 >>= 1
+    emit(rom, 0x801E);  // V0 <<= 1
+    emit(rom, 0x8213);  // V2 ^= V1
+    emit(rom, 0x8011);  // V0 |= V1
+    emit(rom, 0x8022);  // V0 &= V2
+    emit(rom, 0x8107);  // V1 = V0 - V1
+    emit(rom, 0x8024);  // V0 += V2
+    emit(rom, 0x7201);  // V2 += 1
+    emit(rom, 0x1000 | loop);
+}
+
+// Draw heavy (low res): overlapping 8x5 sprites, so most draws collide
+void gen_draw(struct rom *rom) {
+    uint16_t loop;
+
+    emit(rom, 0xA050);  // I = font 0
+    emit(rom, 0x6000);  // V0 = 0
+    emit(rom, 0x6100);  // V1 = 0
+    loop = here(rom);
+    emit(rom, 0xD015);  // draw at V0, V1
+    emit(rom, 0x7003);  // V0 += 3 (overlaps the last sprite)
+    emit(rom, 0xD015);
+    emit(rom, 0x7102);  // V1 += 2
+    emit(rom, 0xD015);
+    emit(rom, 0x1000 | loop);
+}
+
+// Draw heavy (high res): 16x16 SUPER-CHIP sprites
+void gen_hires16(struct rom *rom) {
+    uint16_t loop;
+    uint16_t set_i;
+
+    emit(rom, 0x00FF);  // high res
+    set_i = emit(rom, 0xA000);  // I = sprite, patched below
+    emit(rom, 0x6000);
+    emit(rom, 0x6100);
+    loop = here(rom);
+    emit(rom, 0xD010);  // draw 16x16 at V0, V1
+    emit(rom, 0x7007);  // V0 += 7
+    emit(rom, 0xD010);
+    emit(rom, 0x7105);  // V1 += 5
+    emit(rom, 0x1000 | loop);
+
+    // Patch I to point at the 32 byte sprite following the code
+    rom->data[set_i - PROG_START_ADDR] = 0xA0 | here(rom) >> 8;
+    rom->data[set_i - PROG_START_ADDR + 1] = here(rom) & 0xFF;
+    for (int row = 0; row < 16; row++) {
+        rom->data[rom->len++] = 0xFF >> (row % 8);
+        rom->data[rom->len++] = 0xFF << (row % 8);
+    }
+}
+
+// Scroll storm (high res): every SUPER-CHIP scroll, with a redraw to keep pixels on screen
+void gen_scroll(struct rom *rom) {
+    uint16_t loop;
+
+    emit(rom, 0x00FF);  // high res
+    emit(rom, 0xA0A0);  // I = large font 0
+    emit(rom, 0x6000);
+    emit(rom, 0x6100);
+    loop = here(rom);
+    emit(rom, 0xD01A);  // draw 8x10
+    emit(rom, 0x00C2);  // scroll down 2
+    emit(rom, 0x00FB);  // scroll right 4
+    emit(rom, 0x00FC);  // scroll left 4
+    emit(rom, 0x7009);  // V0 += 9
+    emit(rom, 0x1000 | loop);
+}
+
+// Memory traffic: register dumps/loads and BCD conversion
+void gen_mem(struct rom *rom) {
+    uint16_t loop;
+
+    emit(rom, 0x6000);
+    loop = here(rom);
+    emit(rom, 0xA600);  // I = 0x600 (reset each loop for legacy FX55/FX65)
+    emit(rom, 0xFE55);  // store V0..VE
+    emit(rom, 0xFE65);  // load V0..VE
+    emit(rom, 0xA700);
+    emit(rom, 0xF033);  // BCD of V0
+    emit(rom, 0xF265);  // load V0..V2
+    emit(rom, 0x7001);  // V0 += 1
+    emit(rom, 0x1000 | loop);
+}
+
+// Deep call chains: 2NNN down to the maximum stack depth, then 00EE back up
+void gen_call(struct rom *rom) {
+    uint16_t loop;
+
+    loop = emit(rom, 0x2000 | CALL_SUB_ADDR);
+    emit(rom, 0x1000 | loop);
+
+    // Each subroutine calls the next
+    rom->len = CALL_SUB_ADDR - PROG_START_ADDR;
+    for (int i = 0; i < CALL_DEPTH - 1; i++) {
+        emit(rom, 0x2000 | (here(rom) + 4));
+        emit(rom, 0x00EE);
+    }
+    emit(rom, 0x7001);  // V0 += 1
+    emit(rom, 0x00EE);
+}
+
+struct {
+    const char *name;
+    void (*gen)(struct rom *);
+} roms[] = {
+    {"alu",     gen_alu},
+    {"draw",    gen_draw},
+    {"hires16", gen_hires16},
+    {"scroll",  gen_scroll},
+    {"mem",     gen_mem},
+    {"call",    gen_call}
+};
+
+int main(int argc, char *argv[]) {
+    char path[MAX_PATH_LEN];
+    struct rom rom;
+    FILE *f;
+
+    if (argc != 2) {
+        printf("Usage: %s out_dir\n", argv[0]);
+        return -1;
+    }
+
+    for (unsigned long i = 0; i < sizeof(roms) / sizeof(roms[0]); i++) {
+        memset(&rom, 0, sizeof(rom));
+        roms[i].gen(&rom);
+
+        snprintf(path, MAX_PATH_LEN, "%s/%s.ch8", argv[1], roms[i].name);
+        f = fopen(path, "wb");
+        if (!f) {
+            fprintf(stderr, "romgen: Failed to open '%s'\n", path);
+            return -1;
+        }
+        fwrite(rom.data, 1, rom.len, f);
+        fclose(f);
+        printf("Wrote '%s' (%u bytes)\n", path, rom.len);
+    }
+    return 0;
+}
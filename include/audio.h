@@ -0,0 +1,113 @@
+#ifndef AUDIO_H
+#define AUDIO_H
+
+#include <stdint.h>
+#include <SDL2/SDL.h>
+
+#define AUDIO_TONE_HZ 440
+#define AUDIO_WAVETABLE_BITS 10  // 1024 samples of one period
+#define AUDIO_QUEUE_SIZE 64      // power of two
+
+#define AUDIO_PACE_TARGET_BUFFERS 2  // emulated clock ahead of the samples played, in device buffers
+#define AUDIO_PACE_MAX_BUFFERS 4     // furthest ahead before waiting for the device
+#define AUDIO_PACE_MAX_ADJUST 0.005  // most the emulated clock is sped up or slowed down by
+
+struct audio_event {
+    double time;  // seconds, same clock as `audio_fill`'s time
+    uint8_t on;
+};
+
+uint32_t audio_events_dropped;  // by `audio_push` when the queue was full
+
+uint8_t audio_clocked;  // set before the device starts: `audio_fill_clocked` drives `audio_pace`
+
+// Queue depth (samples the emulated clock is ahead of the device), sampled by `audio_pace`
+uint32_t audio_underruns;  // device played past the emulated clock
+int32_t audio_depth_min;
+int32_t audio_depth_max;
+double audio_depth_sum;
+uint64_t audio_depth_count;
+
+/*
+ * Set up the beep oscillator for a device running at `sample_rate` Hz:
+ * a precomputed sine wavetable, and the phase increment per sample for
+ * `AUDIO_TONE_HZ`. Empties the event queue with the beep off.
+ */
+void audio_init(uint32_t);
+
+/*
+ * Turn the beep on or off at `time_sec`. Called from the emulation thread
+ * only, e.g. when the sound timer starts or stops.
+ * 
+ * Events go through a single producer, single consumer queue to the audio
+ * callback, using atomics rather than SDL's audio lock.
+ * 
+ * Returns 0 on success, or non-zero if the queue was full (the event is
+ * dropped and counted in `audio_events_dropped`).
+ */
+uint8_t audio_push(uint8_t, double);
+
+/*
+ * Fill exactly `len` bytes of 32-bit float mono samples with the beep,
+ * gated by the events pushed since the last call. Called from the audio
+ * callback only.
+ * 
+ * The buffer is taken to cover the time from the last call to `time_sec`
+ * (the current time), so an event is applied at the sample that matches
+ * its time within that span. The beep is then heard one buffer later,
+ * but with the spacing between edges kept to the sample.
+ * 
+ * The phase is a 32-bit integer that wraps once per period, so pitch and
+ * precision do not drift however long the emulator runs, and no sine is
+ * computed per sample.
+ * 
+ * @param1: sample buffer (e.g. an SDL audio callback's stream)
+ * @param2: length in bytes
+ * @param3: current time in seconds
+ */
+void audio_fill(uint8_t *, int, double);
+
+/*
+ * As `audio_fill`, but timed by the device's sample clock rather than
+ * the wall clock: the buffer covers the next `len` bytes of samples
+ * played. Called from the audio callback only, when pacing by
+ * `audio_pace`, so events pushed at its emulated times land on the
+ * matching samples.
+ * 
+ * @param1: sample buffer
+ * @param2: length in bytes
+ */
+void audio_fill_clocked(uint8_t *, int);
+
+/*
+ * Reset audio clock pacing for a device with `buffer_samples` samples
+ * per callback, and the depth statistics.
+ */
+void audio_pace_init(uint32_t);
+
+/*
+ * Emulated time in seconds, on the sample clock of the audio device.
+ * Called from the main loop, in place of reading the wall clock.
+ * 
+ * The emulated clock is kept a target depth of samples
+ * (AUDIO_PACE_TARGET_BUFFERS) ahead of those played. It advances with
+ * the wall clock, sped up or slowed down by up to AUDIO_PACE_MAX_ADJUST
+ * in proportion to how far the depth is from the target, so drift
+ * between the wall clock and the device is absorbed without audible
+ * gaps or visible jumps.
+ * 
+ * If the device plays past the emulated clock, it is an underrun: the
+ * clock jumps forward to the target depth. If the clock gets more than
+ * AUDIO_PACE_MAX_BUFFERS ahead (e.g. after waiting at the debugger),
+ * it waits for the device.
+ * 
+ * @param: wall clock time in seconds
+ */
+double audio_pace(double);
+
+/*
+ * Print the underruns and queue depth seen by `audio_pace`.
+ */
+void audio_pace_report(void);
+
+#endif  // AUDIO_H
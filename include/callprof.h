@@ -0,0 +1,40 @@
+#ifndef CALLPROF_H
+#define CALLPROF_H
+
+#include <stdint.h>
+
+#define CALLPROF_FILE_NAME "ch8-callstacks.folded"
+
+// Average instructions between samples. Each interval is jittered by up to
+// +/- half, so samples do not lock on to loops of the same period.
+#define CALLPROF_INTERVAL 64
+
+// Distinct stacks that can be counted. Samples of further new stacks are dropped.
+#define CALLPROF_MAX_STACKS 4096
+
+// Subroutines (the chip8 stack depth) plus the current pc, see `chip8_call_stack`
+#define CALLPROF_MAX_FRAMES 17
+
+/*
+ * Clear all samples and start sampling from the current cycle.
+ */
+void callprof_init(void);
+
+/*
+ * Sample the guest call stack if the sampling interval has elapsed.
+ * Intended to be called after every `chip8_step`.
+ */
+void callprof_step(void);
+
+/*
+ * Write the samples as folded stacks, one line per distinct stack, e.g.
+ * 
+ *     main;sub_300;sub_342;pc_348 1234
+ * 
+ * which flame graph tools (e.g. flamegraph.pl, speedscope, inferno) read.
+ * 
+ * Returns 0 on success.
+ */
+uint8_t callprof_write(const char *);
+
+#endif  // CALLPROF_H
@@ -18,7 +18,40 @@
 #define CHIP8_QUIRK_LEGACY_MODE 0xF
 #define CHIP8_QUIRK_MODERN_MODE 0x0
 
-#define CHIP8_STATE_FILE_NAME "ch8-state.bin"
+#ifndef CHIP8_STATE_FILE_NAME
+#define CHIP8_STATE_FILE_NAME "ch8-state.bin"  // overridable, e.g. by the benchmarks
+#endif
+
+#define CHIP8_DISASSEMBLY_LEN 24  // see `chip8_disassemble`
+
+// Size of an in-memory machine state snapshot, see `chip8_snapshot`.
+// display + memory + V + pc + I + stack + sp + random state + timers + flags
+#define CHIP8_SNAPSHOT_SIZE (DISPLAY_RES_X * DISPLAY_RES_Y + 0x1000 + 16 + 2 + 2 + 32 + 2 + 4 + 2 + 4)
+
+// Instruction classes, see `chip8_op_class`
+enum chip8_op_class {
+    OP_00E0, OP_00EE, OP_00CN, OP_00FB, OP_00FC, OP_00FD, OP_00FE, OP_00FF,
+    OP_1NNN, OP_2NNN, OP_3XNN, OP_4XNN, OP_5XY0, OP_6XNN, OP_7XNN,
+    OP_8XY0, OP_8XY1, OP_8XY2, OP_8XY3, OP_8XY4, OP_8XY5, OP_8XY6, OP_8XY7, OP_8XYE,
+    OP_9XY0, OP_ANNN, OP_BNNN, OP_CXNN, OP_DXYN,
+    OP_EX9E, OP_EXA1,
+    OP_FX07, OP_FX0A, OP_FX15, OP_FX18, OP_FX1E, OP_FX29, OP_FX30, OP_FX33,
+    OP_FX55, OP_FX65, OP_FX75, OP_FX85,
+    OP_UNRECOGNISED,
+    NUM_OP_CLASSES
+};
+
+// One executed instruction, passed to `chip8_trace_hook`
+struct chip8_trace_record {
+    uint64_t cycle;        // instructions executed before this one
+    uint16_t pc;           // address of the instruction
+    uint16_t instruction;
+    uint16_t I;            // index register after execution
+    uint8_t  reg;          // lowest register changed by execution, or CHIP8_TRACE_NO_REG
+    uint8_t  value;        // new value of `reg`
+};
+
+#define CHIP8_TRACE_NO_REG 0xFF
 
 uint8_t chip8_display[DISPLAY_RES_X * DISPLAY_RES_Y];
 uint8_t chip8_display_updated;
@@ -26,12 +59,56 @@ uint8_t chip8_sound_off;
 uint8_t chip8_quirk_flag;
 uint8_t chip8_exit_flag;
 double chip8_next_timer_update;
+uint64_t chip8_cycles;  // instructions executed since `chip8_init`
+uint16_t chip8_rom_size;  // bytes loaded by `chip8_load_rom`
+
+// Coverage bitmaps, one bit per address (see `CHIP8_COVERED`), cleared by `chip8_init`:
+// - exec:  fetched as an instruction
+// - read:  read as data by DXYN (sprites) or FX65
+// - write: written by FX33 or FX55
+#define CHIP8_COVERAGE_BYTES (0x1000 / 8)
+#define CHIP8_COVERED(bitmap, addr) ((bitmap)[((addr) & 0xFFF) >> 3] >> ((addr) & 7) & 1)
+uint8_t chip8_coverage_exec[CHIP8_COVERAGE_BYTES];
+uint8_t chip8_coverage_read[CHIP8_COVERAGE_BYTES];
+uint8_t chip8_coverage_write[CHIP8_COVERAGE_BYTES];
+
+// Called after every executed instruction when set (e.g. for tracing), NULL otherwise.
+void (*chip8_trace_hook)(const struct chip8_trace_record *);
 
-#ifdef DEBUG
+// Memory is divided into pages, each with a generation count incremented on
+// every write to it. Consumers that cache anything derived from memory can
+// compare generations, or subscribe with `chip8_add_write_observer`.
+#define CHIP8_PAGE_SIZE 0x100
+#define CHIP8_NUM_PAGES (0x1000 / CHIP8_PAGE_SIZE)
+#define CHIP8_MAX_WRITE_OBSERVERS 4
+uint32_t chip8_page_generation[CHIP8_NUM_PAGES];
+
+// Print registers and stack, memory (address, length), or the next instruction.
 void chip8_print_state(void);
 void chip8_print_memory(uint16_t, uint16_t);
 void chip8_print_next_op(void);
-#endif  // DEBUG
+
+/*
+ * Address of the next instruction to execute.
+ */
+uint16_t chip8_pc(void);
+
+/*
+ * Classify an instruction, e.g. 0x8124 -> OP_8XY4.
+ */
+uint8_t chip8_op_class(uint16_t);
+
+/*
+ * Name of an instruction class, e.g. OP_8XY4 -> "8XY4".
+ */
+const char *chip8_op_class_name(uint8_t);
+
+/*
+ * Write the assembly for an instruction, e.g. 0x8124 -> "ADD V1, V2",
+ * into a buffer of at least `CHIP8_DISASSEMBLY_LEN` bytes.
+ * Unrecognised instructions are written as data, e.g. "DW FFFF".
+ */
+void chip8_disassemble(uint16_t, char *);
 
 /*
  * Initialise the chip8 emulator.
@@ -51,6 +128,66 @@ uint8_t chip8_load_rom(const char *);
  */
 void chip8_step(uint8_t, double);
 
+/*
+ * Write a byte of memory as the guest (FX33, FX55). All writes to memory go
+ * through this, or through ROM, state and snapshot loads, which also notify
+ * observers.
+ */
+void chip8_mem_write(uint16_t, uint8_t);
+
+/*
+ * Call `observer(addr, len)` after every write to memory. Writes by
+ * instructions are reported per byte, loads (`chip8_init`, `chip8_load_rom`,
+ * `chip8_load_state`, `chip8_restore`) per changed range. With no observers,
+ * a write only costs a generation increment.
+ * 
+ * Returns 0 on success, or non-zero if `CHIP8_MAX_WRITE_OBSERVERS` are
+ * already registered.
+ */
+uint8_t chip8_add_write_observer(void (*)(uint16_t, uint16_t));
+void chip8_remove_write_observer(void (*)(uint16_t, uint16_t));
+
+/*
+ * Copy `len` bytes of chip8 memory starting at `addr` into a buffer,
+ * wrapping around at the end of memory.
+ */
+void chip8_memory_read(uint16_t, uint8_t *, uint16_t);
+
+/*
+ * The address (high 16 bits) and instruction (low 16 bits) of the
+ * instruction being executed by `chip8_step`, or last executed between
+ * steps. Only reads machine state, so it is safe to call from a signal
+ * handler interrupting `chip8_step`.
+ */
+uint32_t chip8_sample(void);
+
+/*
+ * Fill `frames` (at least 17 entries) with the entry address of each
+ * active subroutine, outermost first, followed by pc. Returns the number
+ * of frames filled.
+ * 
+ * Entry addresses are found from the 2NNN before each return address on the
+ * stack. If that is not a call (e.g. the stack was modified by a state load),
+ * the return address itself is given instead.
+ */
+uint8_t chip8_call_stack(uint16_t *);
+
+/*
+ * 64-bit hash of a display buffer (e.g. `chip8_display`). Equal displays
+ * always hash equal, so unchanged frames can be detected without keeping
+ * a copy: to skip redraws, or to compare frames against golden hashes.
+ */
+uint64_t chip8_display_hash(const uint8_t *);
+
+/*
+ * Write the SUPER-CHIP RPL user flags (FX75) to a `bin` file named after
+ * the loaded ROM's hash, if they changed since the last flush.
+ * 
+ * The flags are only kept in memory while running, so this should be
+ * called before exiting.
+ */
+void chip8_flush_rpl_flags(void);
+
 /*
  * Write all of the emulators state to a `bin` file specified
  * by `CHIP8_STATE_FILE_NAME`.
@@ -63,4 +200,24 @@ void chip8_write_state(void);
  */
 void chip8_load_state(void);
 
+/*
+ * Select the instruction set variant specialised for `chip8_quirk_flag`,
+ * which `chip8_step` then calls directly. Done by `chip8_init`,
+ * `chip8_load_state` and `chip8_restore`; call it after changing the
+ * flag anywhere else.
+ */
+void chip8_select_quirks(void);
+
+/*
+ * Copy the machine state into a `CHIP8_SNAPSHOT_SIZE` byte buffer.
+ * Unlike `chip8_write_state`, no file is involved, making this cheap
+ * enough to be called every frame (e.g. for rewinding).
+ */
+void chip8_snapshot(uint8_t *);
+
+/*
+ * Restore the machine state from a buffer filled by `chip8_snapshot`.
+ */
+void chip8_restore(const uint8_t *);
+
 #endif  // CHIP8_H
\ No newline at end of file
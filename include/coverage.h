@@ -0,0 +1,24 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <stdint.h>
+
+#define COVERAGE_FILE_NAME "ch8-coverage.txt"
+
+/*
+ * Write a coverage report from the chip8 coverage bitmaps: a summary of
+ * how much of the loaded ROM was executed, read and written, followed by
+ * a disassembly of the ROM (and of any code run from outside it) with
+ * each line marked:
+ * 
+ *     X  executed as an instruction
+ *     R  read as data (sprites, FX65)
+ *     W  written (FX33, FX55)
+ * 
+ * Lines with no marks are dead code or unused data for this session.
+ * 
+ * Returns 0 on success.
+ */
+uint8_t coverage_write(const char *);
+
+#endif  // COVERAGE_H
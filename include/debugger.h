@@ -0,0 +1,64 @@
+#ifndef DEBUGGER_H
+#define DEBUGGER_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define DEBUGGER_LINE_LEN 64
+
+// Reverse execution history. A keyframe (machine snapshot) is taken every
+// `DEBUGGER_KEYFRAME_INTERVAL` instructions by default (changed with `k [n]`),
+// and the input of every instruction is logged. Reversing restores the
+// nearest earlier keyframe and re-executes up to the target instruction,
+// so reversing costs at most one interval of re-execution.
+#define DEBUGGER_KEYFRAME_INTERVAL 1024
+#define DEBUGGER_MAX_KEYFRAMES 64
+#define DEBUGGER_LOG_SIZE (1 << 16)  // instructions, power of two
+
+// Breakpoints and write watchpoints, one bit per address (see `CHIP8_COVERED`)
+uint8_t debugger_breakpoints[0x1000 / 8];
+uint8_t debugger_watchpoints[0x1000 / 8];
+
+// Commands are read from here, stdin unless changed (e.g. by tests)
+FILE *debugger_input;
+
+/*
+ * Start a debugging session, stopped before the first instruction.
+ */
+void debugger_init(void);
+
+/*
+ * Perform one `chip8_step`, first prompting for commands if stopped,
+ * stepping or at a breakpoint. Otherwise only the breakpoint bitmap is
+ * checked, so the program runs at full speed until it stops.
+ * 
+ * A write to a watched address (see `debugger_watchpoints`) stops before
+ * the following instruction.
+ * 
+ * Returns non-zero if the prompt was shown, as wall clock time has passed
+ * and the caller's pacing should restart from the current time.
+ */
+uint8_t debugger_step(uint8_t, double);
+
+/*
+ * Forget the reverse execution history, e.g. after the machine state was
+ * replaced by rewinding or loading a state. Watchpoints hit by replacing
+ * the state are also forgotten, as the guest did not write to them.
+ */
+void debugger_reset_history(void);
+
+/*
+ * Restore the machine to how it was before executing the given
+ * instruction (by `chip8_cycles`), re-executing from the nearest keyframe.
+ * 
+ * Returns 0 on success, or non-zero if it is outside the recorded history.
+ */
+uint8_t debugger_seek(uint64_t);
+
+/*
+ * Toggle a breakpoint, or a write watchpoint on `len` bytes.
+ */
+void debugger_toggle_breakpoint(uint16_t);
+void debugger_toggle_watchpoint(uint16_t, uint16_t);
+
+#endif  // DEBUGGER_H
@@ -0,0 +1,38 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <stdint.h>
+
+// Pending records, power of two. Records pushed while full are dropped
+// (but still counted).
+#define LOGGER_RING_SIZE 256
+
+// Maximum number of records printed per `logger_flush`.
+#define LOGGER_LINES_PER_FLUSH 2
+
+/*
+ * Record an unrecognised instruction at the given address.
+ * 
+ * Cheap enough to be called from within instruction execution: only a
+ * counter and a fixed-size record are written, no formatting or I/O.
+ */
+void logger_unrecognised(uint16_t, uint16_t);
+
+/*
+ * Print pending records, at most `LOGGER_LINES_PER_FLUSH` per call.
+ * Remaining records are discarded and reported as suppressed.
+ * Intended to be called once per frame, outside of instruction execution.
+ */
+void logger_flush(void);
+
+/*
+ * Print the number of times each unrecognised instruction was executed.
+ */
+void logger_summary(void);
+
+/*
+ * Clear all pending records and counters.
+ */
+void logger_init(void);
+
+#endif  // LOGGER_H
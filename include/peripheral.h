@@ -5,14 +5,20 @@
 #include <stdint.h>
 #include <SDL2/SDL.h>
 
+#define VIDEO_SINGLE_BUFFER 0
+#define VIDEO_DOUBLE_BUFFER 1  // each frame drawn combined with the last
+#define VIDEO_PHOSPHOR 2       // pixels fade out over a few frames when turned off
+
 char peripheral_quit_flag;
+uint8_t peripheral_fading;  // phosphor still fading: draw again even if the display is unchanged
+uint64_t peripheral_frames_skipped;  // by `sdl_draw_step`, unchanged since the last draw
 
 /*
  * Initialise the front end of the emulator with SDL.
  * Audio, Video and Events (user input) are enabled.
  * 
  * @param1: render scale
- * @param2: use double buffering
+ * @param2: video mode (VIDEO_SINGLE_BUFFER, VIDEO_DOUBLE_BUFFER or VIDEO_PHOSPHOR)
  */
 uint8_t sdl_init(uint8_t, uint8_t);
 
@@ -45,9 +51,10 @@ void sdl_close(void);
  * 
  * Aux:
  * Extra keys are mapped for extra emulator functionality.
- * - F5  = 0x20 = 0010000 (intended for state save)
- * - F9  = 0x21 = 0010001 (intended for state load)
- * - F10 = 0x22 = 0010010 (intended to force redraw of screen)
+ * - F5  = 0x21 = 00100001 (intended for state save)
+ * - F9  = 0x22 = 00100010 (intended for state load)
+ * - F10 = 0x23 = 00100011 (intended to force redraw of screen)
+ * - F7  = 0x24 = 00100100 (intended for rewind, while held)
  * 
  * Usage:
  * - Mask with 0xF0 to determine if any key is down.
@@ -60,12 +67,23 @@ uint8_t sdl_input_step(void);
  * Update the SDL window/renderer with a new image.
  * 
  * Takes a display buffer (from chip8) and draws it on the SDL
- * window/renderer combined with the previous frame (double buffering).
+ * window/renderer combined with the previous frame (double buffering), or
+ * with the fading intensity of recent frames (phosphor).
  * 
  * Updates the previous frame buffer with the passed in buffer values.
  * 
+ * Nothing is drawn if the image would be unchanged, i.e. the display hash
+ * (`chip8_display_hash`) matches the last frame drawn (and the one before
+ * it when double buffering) and nothing is fading.
+ * 
  * @param: Pointer to 64x32 CHIP-8 display buffer
  */
 void sdl_draw_step(uint8_t *);
 
+/*
+ * Make the next `sdl_draw_step` draw, even if the display is unchanged
+ * (e.g. a forced re-draw).
+ */
+void sdl_draw_invalidate(void);
+
 #endif  // PERIPHERAL_H
\ No newline at end of file
@@ -0,0 +1,51 @@
+#ifndef PIXEL_H
+#define PIXEL_H
+
+#include <stdint.h>
+
+#define PIXEL_ON  0xFFFFFFFF  // ARGB8888 white
+#define PIXEL_OFF 0xFF000000  // ARGB8888 black
+
+#define PIXEL_PHOSPHOR_DECAY 0x40  // intensity lost per frame, fully faded after 4 frames
+
+/*
+ * Expand a display buffer (one byte per pixel, 0 or 1) into ARGB8888
+ * texels, e.g. a locked streaming texture with `pitch` bytes per row.
+ * 
+ * A texel is on if the pixel is on in `display`, or in `last_frame` when
+ * double buffering. Pass NULL as `last_frame` for single buffering.
+ * 
+ * In the same pass, `last_frame` is overwritten with `display`, ready to
+ * be the last frame of the next call, so no separate copy is needed.
+ * 
+ * Expands 16 (SSE2) or 32 (AVX2) pixels at a time when the build targets
+ * them (e.g. `-mavx2`), with scalar code otherwise.
+ * 
+ * @param1: texels, DISPLAY_RES_X * DISPLAY_RES_Y
+ * @param2: pitch, bytes per row of texels
+ * @param3: display
+ * @param4: last frame or NULL
+ */
+void pixel_expand(uint32_t *, int, const uint8_t *, uint8_t *);
+
+/*
+ * Expand a display buffer into grey ARGB8888 texels with phosphor
+ * persistence: a pixel that turns off fades out over several frames,
+ * rather than disappearing (single buffering) or staying on for one
+ * extra frame (double buffering).
+ * 
+ * `intensity` (one byte per pixel, zero to start) is updated in place:
+ * full for pixels that are on, otherwise reduced by `decay`.
+ * 
+ * Returns non-zero while any pixel is still fading, i.e. the next call
+ * would give a different image even if the display is unchanged.
+ * 
+ * @param1: texels, DISPLAY_RES_X * DISPLAY_RES_Y
+ * @param2: pitch, bytes per row of texels
+ * @param3: display
+ * @param4: intensity
+ * @param5: decay per call, e.g. PIXEL_PHOSPHOR_DECAY
+ */
+uint8_t pixel_expand_phosphor(uint32_t *, int, const uint8_t *, uint8_t *, uint8_t);
+
+#endif  // PIXEL_H
@@ -0,0 +1,76 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/*
+ * Instruction level profiling, only compiled in with `-D PROFILE`
+ * (see the `profile` make target). Otherwise all of the below macros
+ * expand to nothing.
+ * 
+ * Records per instruction class execution counts and host time (in
+ * timestamp counter ticks), and a per address execution count of guest
+ * code (PC hotness).
+ */
+
+#define PROFILE_REPORT_FILE_NAME "ch8-profile.json"
+
+#ifdef PROFILE
+
+// Start timing the instruction at the given address
+#define PROFILE_BEGIN(addr) \
+    uint16_t profile_addr_ = (addr); \
+    uint64_t profile_start_ = profile_ticks()
+
+// Stop timing and record the instruction started by `PROFILE_BEGIN`
+#define PROFILE_END(instruction) \
+    profile_record((instruction), profile_addr_, profile_ticks() - profile_start_)
+
+// Install the report signal handler (SIGUSR1)
+#define PROFILE_INIT() profile_init()
+
+// Print a report if one was requested by signal since the last poll
+#define PROFILE_POLL() profile_poll()
+
+// Print a final report
+#define PROFILE_REPORT() profile_report()
+
+/*
+ * Read the host timestamp counter.
+ */
+static inline uint64_t profile_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo;
+    uint32_t hi;
+    __asm__ volatile ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t) hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+#else
+    return 0;  // no counter: execution counts only
+#endif
+}
+
+void profile_record(uint16_t, uint16_t, uint64_t);
+void profile_init(void);
+void profile_poll(void);
+
+/*
+ * Print a text report to stdout and write the same data as JSON to
+ * `PROFILE_REPORT_FILE_NAME`.
+ */
+void profile_report(void);
+
+#else
+
+#define PROFILE_BEGIN(addr)
+#define PROFILE_END(instruction)
+#define PROFILE_INIT()
+#define PROFILE_POLL()
+#define PROFILE_REPORT()
+
+#endif  // PROFILE
+
+#endif  // PROFILE_H
@@ -0,0 +1,42 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <stdint.h>
+
+#define REWIND_SECONDS 10
+#define REWIND_FRAMES_PER_SECOND 60
+#define REWIND_MAX_FRAMES (REWIND_SECONDS * REWIND_FRAMES_PER_SECOND)
+
+// Bytes available for encoded frame deltas. Once used up, the oldest frames
+// are dropped, so memory stays bounded regardless of session length.
+#define REWIND_POOL_SIZE (1 << 20)
+
+/*
+ * Clear the rewind history. The next `rewind_push` becomes the oldest
+ * frame that can be rewound to.
+ */
+void rewind_init(void);
+
+/*
+ * Record the current chip8 state as the newest frame in the history.
+ * Intended to be called once per displayed frame.
+ * 
+ * Only the XOR difference to the previously recorded frame is kept,
+ * run-length encoded, as most of memory and the display is unchanged
+ * between frames.
+ */
+void rewind_push(void);
+
+/*
+ * Step the chip8 state back by one recorded frame.
+ * 
+ * Returns 0 on success, or non-zero if there is no earlier frame.
+ */
+uint8_t rewind_step(void);
+
+/*
+ * The number of frames that can currently be rewound.
+ */
+uint16_t rewind_frames_available(void);
+
+#endif  // REWIND_H
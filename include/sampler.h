@@ -0,0 +1,41 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stdint.h>
+
+// Samples per second of process CPU time. The kernel may deliver fewer,
+// as the timer is rounded up to its tick (e.g. 250 Hz).
+#define SAMPLER_HZ 1000
+
+// Samples buffered between polls. Samples taken while it is full are dropped.
+#define SAMPLER_BUFFER_SIZE 1024  // power of two
+
+#define SAMPLER_TOP_ADDRS 16
+
+/*
+ * Block SIGPROF in the calling thread. Call before any other threads are
+ * created (e.g. `sdl_init`, `trace_open`), so they inherit the blocked
+ * signal and every sample interrupts the emulation thread.
+ */
+void sampler_init(void);
+
+/*
+ * Install the SIGPROF handler, unblock it in the calling thread and start
+ * the profiling timer.
+ * 
+ * Returns 0 on success.
+ */
+uint8_t sampler_start(void);
+
+/*
+ * Move buffered samples into the per-address and per-class counts.
+ * Intended to be called regularly, e.g. once per displayed frame.
+ */
+void sampler_poll(void);
+
+/*
+ * Stop the timer and print the sampled pc and instruction class distribution.
+ */
+void sampler_report(void);
+
+#endif  // SAMPLER_H
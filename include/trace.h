@@ -0,0 +1,90 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "chip8.h"
+
+#define TRACE_FILE_NAME "ch8-trace.bin"
+
+/*
+ * Trace file format
+ * 
+ * Header: "CH8T", version (1 byte), 3 reserved bytes.
+ * 
+ * Followed by one variable length record per executed instruction. Each
+ * record starts with a flags byte, and only the fields that cannot be
+ * predicted from the previous records follow it (little endian):
+ * - TRACE_FLAG_CYCLE:  cycle - (previous cycle + 1), LEB128 varint.
+ *                      Otherwise cycle = previous cycle + 1.
+ * - TRACE_FLAG_PC:     pc (2 bytes). Otherwise pc = previous pc + 2.
+ * - TRACE_FLAG_OP:     instruction (2 bytes). Otherwise the instruction
+ *                      last seen at this pc.
+ * - TRACE_FLAG_I:      I (2 bytes). Otherwise I is unchanged.
+ * - TRACE_FLAG_REG:    register (1 byte), new value (1 byte).
+ *                      Otherwise no register changed.
+ * 
+ * Straight-line code in a loop typically takes 1-3 bytes per record.
+ * The first record's cycle is relative to -1 and its pc to 0x1FE.
+ */
+#define TRACE_MAGIC "CH8T"
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 8
+
+#define TRACE_FLAG_CYCLE 0x01
+#define TRACE_FLAG_PC    0x02
+#define TRACE_FLAG_OP    0x04
+#define TRACE_FLAG_I     0x08
+#define TRACE_FLAG_REG   0x10
+
+#define TRACE_INITIAL_PC 0x1FE
+#define TRACE_ADDR_SPACE 0x1000
+
+#define TRACE_READER_BUFFER_SIZE (1 << 16)
+
+// Streaming decoder state, see `trace_reader_open`
+struct trace_reader {
+    FILE *f;
+    uint8_t buffer[TRACE_READER_BUFFER_SIZE];
+    uint32_t pos;
+    uint32_t len;
+    struct chip8_trace_record last;
+    uint16_t ops[TRACE_ADDR_SPACE];
+};
+
+/*
+ * Start tracing to the file at the given path. Encoded records are
+ * written by a background thread.
+ * 
+ * Returns 0 on success.
+ */
+uint8_t trace_open(const char *);
+
+/*
+ * Encode one record. Intended to be set as `chip8_trace_hook`.
+ */
+void trace_record(const struct chip8_trace_record *);
+
+/*
+ * Write out remaining records, stop the background thread and close the file.
+ */
+void trace_close(void);
+
+/*
+ * Open a trace file for reading. Records are decoded one at a time from a
+ * fixed size buffer, so traces of any length can be read.
+ * 
+ * Returns 0 on success.
+ */
+uint8_t trace_reader_open(struct trace_reader *, const char *);
+
+/*
+ * Decode the next record. Returns 0 once there are no more records, or
+ * if the trace ends part way through a record (e.g. the emulator was
+ * killed) or is corrupt, which is reported on stderr.
+ */
+uint8_t trace_reader_next(struct trace_reader *, struct chip8_trace_record *);
+
+void trace_reader_close(struct trace_reader *);
+
+#endif  // TRACE_H
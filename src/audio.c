@@ -0,0 +1,166 @@
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "audio.h"
+
+#define AUDIO_WAVETABLE_SIZE (1 << AUDIO_WAVETABLE_BITS)
+#define AUDIO_TWO_PI 6.28318530717958647692
+
+float audio_wavetable[AUDIO_WAVETABLE_SIZE];
+uint32_t audio_phase;
+uint32_t audio_phase_step;  // 2^32 = one period
+uint32_t audio_sample_rate;
+
+// Sound on/off events, produced by the emulation thread and consumed by the
+// audio callback. Each index is only written by one side. Indices run to twice
+// the queue size, so a full queue (head - tail = size) differs from empty.
+#define AUDIO_QUEUE_INDICES (2 * AUDIO_QUEUE_SIZE)
+struct audio_event audio_queue[AUDIO_QUEUE_SIZE];
+SDL_atomic_t audio_queue_head;  // next to write, producer
+SDL_atomic_t audio_queue_tail;  // next to read, consumer
+
+// Consumer (audio callback) state
+uint8_t audio_on;
+double audio_fill_time;  // time of the end of the last buffer filled, 0 before the first
+
+// Audio clock pacing: the callback counts the samples played, and the main
+// loop keeps the emulated clock ahead of them. Counts are published as their
+// low 32 bits, which the main loop accumulates as differences.
+uint64_t audio_clock;                // samples played, callback only
+SDL_atomic_t audio_clock_published;  // low 32 bits of `audio_clock`
+uint32_t audio_pace_seen;            // main loop only from here
+double audio_pace_played;            // samples played, as seen by the main loop
+double audio_pace_clock;             // emulated clock, in samples
+double audio_pace_wall;              // wall time of the last call, 0 before the first
+double audio_pace_target;            // depths, in samples
+double audio_pace_max;
+
+void audio_init(uint32_t sample_rate) {
+    for (int i = 0; i < AUDIO_WAVETABLE_SIZE; i++) {
+        audio_wavetable[i] = (float) sin(AUDIO_TWO_PI * i / AUDIO_WAVETABLE_SIZE);
+    }
+    audio_phase = 0;
+    audio_phase_step = (uint32_t) (((uint64_t) AUDIO_TONE_HZ << 32) / sample_rate);
+    audio_sample_rate = sample_rate;
+
+    SDL_AtomicSet(&audio_queue_head, 0);
+    SDL_AtomicSet(&audio_queue_tail, 0);
+    audio_on = 0;
+    audio_fill_time = 0;
+    audio_events_dropped = 0;
+    audio_clock = 0;
+    SDL_AtomicSet(&audio_clock_published, 0);
+}
+
+uint8_t audio_push(uint8_t on, double time_sec) {
+    int head = SDL_AtomicGet(&audio_queue_head);
+
+    if ((head - SDL_AtomicGet(&audio_queue_tail) + AUDIO_QUEUE_INDICES) % AUDIO_QUEUE_INDICES == AUDIO_QUEUE_SIZE) {
+        audio_events_dropped++;
+        return 1;
+    }
+    audio_queue[head % AUDIO_QUEUE_SIZE].on = on;
+    audio_queue[head % AUDIO_QUEUE_SIZE].time = time_sec;
+    SDL_MemoryBarrierRelease();  // event written before it is published
+    SDL_AtomicSet(&audio_queue_head, (head + 1) % AUDIO_QUEUE_INDICES);
+    return 0;
+}
+
+void audio_fill(uint8_t *stream, int len, double time_sec) {
+    int samples = len / (int) sizeof(float);
+    int tail = SDL_AtomicGet(&audio_queue_tail);
+    int head = SDL_AtomicGet(&audio_queue_head);
+    struct audio_event *event;
+    double buffer_start;
+    float sample;
+
+    SDL_MemoryBarrierAcquire();  // events published before `head` are visible
+
+    // The buffer covers the time since the last fill, so an event is placed
+    // as many samples into it as it happened after the last fill
+    buffer_start = audio_fill_time ? audio_fill_time : time_sec - (double) samples / audio_sample_rate;
+    audio_fill_time = time_sec;
+
+    for (int i = 0; i < samples; i++) {
+        // Apply the events due by this sample, late ones at the first sample
+        while (tail != head && (audio_queue[tail % AUDIO_QUEUE_SIZE].time - buffer_start) * audio_sample_rate <= i) {
+            event = &audio_queue[tail % AUDIO_QUEUE_SIZE];
+            if (event->on && !audio_on) {
+                audio_phase = 0;  // every beep starts the same way
+            }
+            audio_on = event->on;
+            tail = (tail + 1) % AUDIO_QUEUE_INDICES;
+        }
+
+        sample = audio_on ? audio_wavetable[audio_phase >> (32 - AUDIO_WAVETABLE_BITS)] : 0.0f;
+        audio_phase += audio_phase_step;
+        // memcpy as the stream need not be aligned for floats
+        memcpy(&stream[i * sizeof(sample)], &sample, sizeof(sample));
+    }
+    SDL_AtomicSet(&audio_queue_tail, tail);
+}
+
+void audio_fill_clocked(uint8_t *stream, int len) {
+    audio_clock += len / (int) sizeof(float);
+    audio_fill(stream, len, (double) audio_clock / audio_sample_rate);
+    SDL_AtomicSet(&audio_clock_published, (int) (uint32_t) audio_clock);  // after the buffer is filled
+}
+
+void audio_pace_init(uint32_t buffer_samples) {
+    audio_pace_seen = (uint32_t) SDL_AtomicGet(&audio_clock_published);
+    audio_pace_played = 0;
+    audio_pace_clock = 0;
+    audio_pace_wall = 0;
+    audio_pace_target = (double) buffer_samples * AUDIO_PACE_TARGET_BUFFERS;
+    audio_pace_max = (double) buffer_samples * AUDIO_PACE_MAX_BUFFERS;
+
+    audio_underruns = 0;
+    audio_depth_min = INT32_MAX;
+    audio_depth_max = INT32_MIN;
+    audio_depth_sum = 0;
+    audio_depth_count = 0;
+}
+
+double audio_pace(double wall_sec) {
+    uint32_t seen = (uint32_t) SDL_AtomicGet(&audio_clock_published);
+    double depth;
+    double adjust;
+
+    audio_pace_played += (uint32_t) (seen - audio_pace_seen);  // wraps with the count
+    audio_pace_seen = seen;
+
+    if (!audio_pace_wall) {
+        audio_pace_clock = audio_pace_played + audio_pace_target;
+    } else {
+        // Proportional rate control, towards the target depth
+        adjust = AUDIO_PACE_MAX_ADJUST * (audio_pace_target - (audio_pace_clock - audio_pace_played)) / audio_pace_target;
+        adjust = adjust > AUDIO_PACE_MAX_ADJUST ? AUDIO_PACE_MAX_ADJUST : adjust;
+        adjust = adjust < -AUDIO_PACE_MAX_ADJUST ? -AUDIO_PACE_MAX_ADJUST : adjust;
+        audio_pace_clock += (wall_sec - audio_pace_wall) * audio_sample_rate * (1 + adjust);
+    }
+    audio_pace_wall = wall_sec;
+
+    depth = audio_pace_clock - audio_pace_played;
+    audio_depth_min = depth < audio_depth_min ? (int32_t) depth : audio_depth_min;
+    audio_depth_max = depth > audio_depth_max ? (int32_t) depth : audio_depth_max;
+    audio_depth_sum += depth;
+    audio_depth_count++;
+
+    if (depth < 0) {
+        audio_underruns++;
+        audio_pace_clock = audio_pace_played + audio_pace_target;
+    } else if (depth > audio_pace_max) {
+        audio_pace_clock = audio_pace_played + audio_pace_max;
+    }
+    return audio_pace_clock / audio_sample_rate;
+}
+
+void audio_pace_report(void) {
+    if (!audio_depth_count) {
+        return;
+    }
+    printf("* Audio sync: %u underruns, queue depth min %d / mean %.0f / max %d samples (target %.0f)\n",
+        audio_underruns, (int) audio_depth_min, audio_depth_sum / audio_depth_count,
+        (int) audio_depth_max, audio_pace_target);
+}
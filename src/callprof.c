@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "callprof.h"
+
+#define CALLPROF_TABLE_SIZE (CALLPROF_MAX_STACKS * 2)  // power of two, at most half full
+
+struct callprof_stack {
+    uint64_t count;  // 0 when the entry is unused
+    uint8_t depth;   // frames used, including pc
+    uint16_t frames[CALLPROF_MAX_FRAMES];
+};
+
+struct callprof_stack callprof_table[CALLPROF_TABLE_SIZE];
+uint32_t callprof_stacks_used;
+uint64_t callprof_samples;
+uint64_t callprof_dropped;
+uint64_t callprof_next_sample;
+uint32_t callprof_rng;
+
+// Separate from `random_state`, so sampling does not change what guest CXNN
+// instructions see (the guest generator is part of the machine state snapshot)
+uint32_t callprof_random(void) {
+    callprof_rng ^= callprof_rng << 13;
+    callprof_rng ^= callprof_rng >> 17;
+    callprof_rng ^= callprof_rng << 5;
+    return callprof_rng;
+}
+
+void callprof_schedule(void) {
+    callprof_next_sample = chip8_cycles + CALLPROF_INTERVAL / 2 + callprof_random() % CALLPROF_INTERVAL;
+}
+
+uint32_t callprof_hash(const uint16_t *frames, uint8_t depth) {
+    uint32_t hash = 2166136261u;  // FNV-1a
+
+    for (uint8_t i = 0; i < depth; i++) {
+        hash = (hash ^ (frames[i] & 0xFF)) * 16777619u;
+        hash = (hash ^ (frames[i] >> 8)) * 16777619u;
+    }
+    return hash;
+}
+
+void callprof_init(void) {
+    memset(callprof_table, 0, sizeof(callprof_table));
+    callprof_stacks_used = 0;
+    callprof_samples = 0;
+    callprof_dropped = 0;
+    callprof_rng = 0x9E3779B9;
+    callprof_schedule();
+}
+
+void callprof_step(void) {
+    uint16_t frames[CALLPROF_MAX_FRAMES];
+    uint8_t depth;
+    uint32_t i;
+
+    if (chip8_cycles < callprof_next_sample) {
+        return;
+    }
+    callprof_schedule();
+    callprof_samples++;
+
+    depth = chip8_call_stack(frames);
+
+    i = callprof_hash(frames, depth) & (CALLPROF_TABLE_SIZE - 1);
+    while (callprof_table[i].count) {
+        if (callprof_table[i].depth == depth
+                && memcmp(callprof_table[i].frames, frames, depth * sizeof(uint16_t)) == 0) {
+            callprof_table[i].count++;
+            return;
+        }
+        i = (i + 1) & (CALLPROF_TABLE_SIZE - 1);
+    }
+    if (callprof_stacks_used == CALLPROF_MAX_STACKS) {
+        callprof_dropped++;
+        return;
+    }
+    callprof_table[i].count = 1;
+    callprof_table[i].depth = depth;
+    memcpy(callprof_table[i].frames, frames, depth * sizeof(uint16_t));
+    callprof_stacks_used++;
+}
+
+uint8_t callprof_write(const char *path) {
+    struct callprof_stack *entry;
+    FILE *f;
+
+    f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "callprof_write: Failed to open '%s'\n", path);
+        return 1;
+    }
+    for (uint32_t i = 0; i < CALLPROF_TABLE_SIZE; i++) {
+        entry = &callprof_table[i];
+        if (!entry->count) {
+            continue;
+        }
+        fprintf(f, "main");
+        for (uint8_t frame = 0; frame < entry->depth - 1; frame++) {
+            fprintf(f, ";sub_%03x", entry->frames[frame]);
+        }
+        fprintf(f, ";pc_%03x %llu\n", entry->frames[entry->depth - 1], (unsigned long long) entry->count);
+    }
+    fclose(f);
+
+    printf("* Call stack profile: %llu samples, %u distinct stacks written to '%s'\n",
+        (unsigned long long) callprof_samples, callprof_stacks_used, path);
+    if (callprof_dropped) {
+        printf("(%llu samples of new stacks dropped, table full)\n", (unsigned long long) callprof_dropped);
+    }
+    return 0;
+}
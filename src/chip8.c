@@ -1,4 +1,6 @@
 #include "chip8.h"
+#include "logger.h"
+#include "profile.h"
 
 #define TOTAL_MEMORY 0x1000    // 4096
 #define FONT_START_ADDR 0x50   // 80
@@ -9,21 +11,49 @@
 
 #define TIMER_HZ_DELAY 1.0 / 60
 
-#define SUPER_CHIP_RPL_FILE "rpl-flags.bin"
+#define SUPER_CHIP_RPL_FILE "rpl-flags-%08x.bin"  // per ROM hash
+#define SUPER_CHIP_RPL_FILE_LEN 32
+#define NUM_RPL_FLAGS 8
+
+#define RANDOM_SEED 0x2545F491  // any non-zero value
+
+#define FNV_OFFSET_BASIS 0x811C9DC5
+#define FNV_PRIME 0x01000193
+#define DISPLAY_HASH_LANES 4
+#define DISPLAY_HASH_PRIME 0x9E3779B97F4A7C15ULL
 #define SUPER_SCROLL_AMOUNT 4
+#define SPRITE_CACHE_SIZE 64  // entries, direct mapped
+
+// Mark an address in a coverage bitmap
+#define COVER(bitmap, addr) ((bitmap)[((addr) % TOTAL_MEMORY) >> 3] |= 1 << ((addr) & 7))
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ALWAYS_INLINE inline
+#endif
+
 
 // Memory
 uint8_t memory[TOTAL_MEMORY];
 
+// Memory write observers, see `chip8_add_write_observer`
+void (*write_observers[CHIP8_MAX_WRITE_OBSERVERS])(uint16_t, uint16_t);
+uint8_t write_observer_count;
+
 // Registers
 uint8_t  V[NUM_GP_REGISTERS];  // last = flag register
 uint16_t pc;  // program counter
+uint16_t step_pc;  // address of the instruction in `chip8_step`, for sampling
 uint16_t I;   // index register
 
 // Stack
 uint16_t stack[STACK_SIZE];
 uint16_t sp;  // stack pointer
 
+// CXNN random number generator, part of the machine state so execution is reproducible
+uint32_t random_state;
+
 // Timers
 uint8_t delay_timer;
 uint8_t sound_timer;
@@ -31,6 +61,13 @@ uint8_t sound_timer;
 // (SUPER-CHIP 1.0) low/high resolution flag
 uint8_t low_res_mode;
 
+// (SUPER-CHIP 1.0) RPL user flags. Loaded from file on first use and
+// only written back by `chip8_flush_rpl_flags`.
+uint8_t  rpl_flags[NUM_RPL_FLAGS];
+uint8_t  rpl_flags_loaded;
+uint8_t  rpl_flags_dirty;
+uint32_t rom_hash;  // FNV-1a of the loaded ROM, keys the RPL flags file
+
 // courtesy of https://tobiasvl.github.io/blog/write-a-chip-8-emulator/
 uint8_t fonts[] = {
     0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
@@ -178,14 +215,226 @@ void update_timers(double time_sec) {
     }
 }
 
+// The RPL flags file for the loaded ROM.
+void rpl_flags_file_name(char *buffer) {
+    snprintf(buffer, SUPER_CHIP_RPL_FILE_LEN, SUPER_CHIP_RPL_FILE, rom_hash);
+}
+
+// Read the RPL flags for the loaded ROM once. A missing file leaves all flags cleared.
+void load_rpl_flags(void) {
+    char file_name[SUPER_CHIP_RPL_FILE_LEN];
+    FILE *f;
+
+    rpl_flags_loaded = 1;
+    rpl_flags_file_name(file_name);
+    f = fopen(file_name, "rb");
+    if (!f) {
+        return;
+    }
+    // A short file only fills the first flags, the rest stay cleared
+    fread(rpl_flags, sizeof(uint8_t), NUM_RPL_FLAGS, f);
+    fclose(f);
+}
+
+// Bump the generation of pages in [addr, addr + len) and notify observers.
+void memory_changed(uint16_t addr, uint16_t len) {
+    for (uint16_t page = addr / CHIP8_PAGE_SIZE; page <= (addr + len - 1) / CHIP8_PAGE_SIZE; page++) {
+        chip8_page_generation[page]++;
+    }
+    for (uint8_t i = 0; i < write_observer_count; i++) {
+        (*write_observers[i])(addr, len);
+    }
+}
+
+void chip8_mem_write(uint16_t addr, uint8_t value) {
+    addr %= TOTAL_MEMORY;
+    memory[addr] = value;
+    COVER(chip8_coverage_write, addr);
+    chip8_page_generation[addr / CHIP8_PAGE_SIZE]++;
+    for (uint8_t i = 0; i < write_observer_count; i++) {
+        (*write_observers[i])(addr, 1);
+    }
+}
+
+// Replace all of memory (state and snapshot loads). Only pages that differ are
+// written, so observers are not told about the unchanged majority.
+void memory_load(const uint8_t *data) {
+    for (uint16_t addr = 0; addr < TOTAL_MEMORY; addr += CHIP8_PAGE_SIZE) {
+        if (memcmp(&memory[addr], &data[addr], CHIP8_PAGE_SIZE) != 0) {
+            memcpy(&memory[addr], &data[addr], CHIP8_PAGE_SIZE);
+            memory_changed(addr, CHIP8_PAGE_SIZE);
+        }
+    }
+}
+
+uint8_t chip8_add_write_observer(void (*observer)(uint16_t, uint16_t)) {
+    if (write_observer_count == CHIP8_MAX_WRITE_OBSERVERS) {
+        return 1;
+    }
+    write_observers[write_observer_count++] = observer;
+    return 0;
+}
+
+void chip8_remove_write_observer(void (*observer)(uint16_t, uint16_t)) {
+    for (uint8_t i = 0; i < write_observer_count; i++) {
+        if (write_observers[i] == observer) {
+            write_observers[i] = write_observers[--write_observer_count];
+            return;
+        }
+    }
+}
+
+// Each bit of a byte doubled, e.g. 0b10100000 -> 0b1100110000000000, for low res sprites
+uint16_t double_bits[256];
+
+// Each bit of a byte as one display pixel (0 or 1), leftmost bit first in memory
+uint64_t expand_bits[256];
+
+// Sprites expanded to display pixels, 8 pixels per word: up to 16 rows of 32
+// pixels (a low res 16x16 sprite). Keyed by (I, N, low_res_mode), and valid
+// while the generations of the pages holding the sprite are unchanged.
+struct sprite_cache_entry {
+    uint16_t I;
+    uint8_t n;  // 0 for 16x16
+    uint8_t low_res;
+    uint8_t valid;
+    uint32_t generation[2];  // first and last page of the sprite
+    uint64_t rows[16][4];
+};
+
+struct sprite_cache_entry sprite_cache[SPRITE_CACHE_SIZE];
+
+// A sprite (at most 32 bytes) then spans at most two pages, its first and last
+#if CHIP8_PAGE_SIZE < 32
+#error "CHIP8_PAGE_SIZE must hold a 16x16 sprite"
+#endif
+
+// Expanded rows of the sprite at I (N rows of 8 pixels, or 16 rows of 16 for
+// N = 0), from the cache or expanded now. Low res rows are doubled in width.
+const struct sprite_cache_entry *sprite_lookup(uint8_t n) {
+    uint8_t bytes_per_row = n ? 1 : 2;
+    uint8_t rows = n ? n : 16;
+    uint16_t first = I % TOTAL_MEMORY;  // legacy FX55/FX65 can leave I past the end
+    uint16_t last = (first + rows * bytes_per_row - 1) % TOTAL_MEMORY;
+    uint32_t generation_first = chip8_page_generation[first / CHIP8_PAGE_SIZE];
+    uint32_t generation_last = chip8_page_generation[last / CHIP8_PAGE_SIZE];
+    struct sprite_cache_entry *entry = &sprite_cache[((I * 0x9E3779B1u) >> 24 ^ n ^ low_res_mode << 4) % SPRITE_CACHE_SIZE];
+    uint8_t byte;
+
+    if (entry->valid && entry->I == I && entry->n == n && entry->low_res == low_res_mode
+        && entry->generation[0] == generation_first && entry->generation[1] == generation_last) {
+        return entry;
+    }
+
+    entry->I = I;
+    entry->n = n;
+    entry->low_res = low_res_mode;
+    entry->valid = 1;
+    entry->generation[0] = generation_first;
+    entry->generation[1] = generation_last;
+    for (uint8_t dr = 0; dr < rows; dr++) {
+        for (uint8_t col = 0; col < bytes_per_row; col++) {
+            byte = memory[(I + dr * bytes_per_row + col) % TOTAL_MEMORY];
+            // Marked once per expansion: coverage is only cleared by chip8_init, which
+            // also invalidates every entry
+            COVER(chip8_coverage_read, I + dr * bytes_per_row + col);
+            if (low_res_mode) {
+                entry->rows[dr][2 * col] = expand_bits[double_bits[byte] >> 8];
+                entry->rows[dr][2 * col + 1] = expand_bits[double_bits[byte] & 0xFF];
+            } else {
+                entry->rows[dr][col] = expand_bits[byte];
+            }
+        }
+    }
+    return entry;
+}
+
+// XOR 8 pixels into the display at row `y`, column `x`, clipped at the right
+// edge. Returns how many of them were on.
+uint8_t xor_pixels(uint16_t y, uint16_t x, uint64_t sprite) {
+    uint8_t *row = &chip8_display[y * DISPLAY_RES_X];
+    uint8_t collisions = 0;
+    uint64_t pixels;
+
+    if (x + 8 > DISPLAY_RES_X) {
+        // The display, or its last row, may end within these 8 pixels
+        uint8_t sprite_pixels[8];
+
+        memcpy(sprite_pixels, &sprite, sizeof(sprite));
+        for (uint8_t i = 0; x + i < DISPLAY_RES_X; i++) {
+            collisions += row[x + i] & sprite_pixels[i];
+            row[x + i] ^= sprite_pixels[i];
+        }
+        return collisions;
+    }
+    memcpy(&pixels, &row[x], sizeof(pixels));
+    // Pixels are 0 or 1, so the sum of the bytes is the top byte of the product
+    collisions = ((pixels & sprite) * 0x0101010101010101) >> 56;
+    pixels ^= sprite;
+    memcpy(&row[x], &pixels, sizeof(pixels));
+    return collisions;
+}
+
+// DXYN/DXY0 in high res mode (128x64). N rows of 8 pixels, or for N = 0,
+// 16 rows of 16 pixels (SUPER-CHIP 1.1). Sprites are clipped at the display
+// edges. Returns VF: the number of pixels turned off, or for N = 0 the
+// number of rows with a collision.
+uint8_t draw_high_res(uint16_t dx, uint16_t dy, uint8_t n) {
+    const struct sprite_cache_entry *sprite = sprite_lookup(n);
+    uint8_t rows = n ? n : 16;
+    uint8_t words = n ? 1 : 2;
+    uint8_t collisions = 0;
+    uint8_t row_collisions;
+
+    for (uint16_t dr = 0; dr < rows && dy + dr < DISPLAY_RES_Y; dr++) {
+        row_collisions = 0;
+        for (uint8_t word = 0; word < words && dx + 8 * word < DISPLAY_RES_X; word++) {
+            row_collisions += xor_pixels(dy + dr, dx + 8 * word, sprite->rows[dr][word]);
+        }
+        collisions += n ? row_collisions : row_collisions > 0;
+    }
+    return collisions;
+}
+
+// DXYN/DXY0 in low res mode (64x32), each pixel drawn as 2x2 on the display.
+// Returns VF: 1 if any pixel was turned off.
+uint8_t draw_low_res(uint16_t dx, uint16_t dy, uint8_t n) {
+    const struct sprite_cache_entry *sprite = sprite_lookup(n);
+    uint8_t rows = n ? n : 16;
+    uint8_t words = n ? 2 : 4;
+    uint8_t collisions = 0;
+
+    for (uint16_t dr = 0; dr < rows && dy + dr < (DISPLAY_RES_Y >> 1); dr++) {
+        for (uint8_t word = 0; word < words && 2 * dx + 8 * word < DISPLAY_RES_X; word++) {
+            collisions |= xor_pixels(2 * (dy + dr), 2 * dx + 8 * word, sprite->rows[dr][word]);
+            collisions |= xor_pixels(2 * (dy + dr) + 1, 2 * dx + 8 * word, sprite->rows[dr][word]);
+        }
+    }
+    return collisions > 0;
+}
+
+// Drawing kernel for each mode, indexed by `low_res_mode` (set by 00FE/00FF)
+uint8_t (*const draw_kernels[2])(uint16_t, uint16_t, uint8_t) = {draw_high_res, draw_low_res};
+
+// xorshift32
+uint8_t random_byte(void) {
+    random_state ^= random_state << 13;
+    random_state ^= random_state >> 17;
+    random_state ^= random_state << 5;
+    return random_state >> 24;
+}
+
 // Retrieve the next instruction from memory and increment the program counter.
 uint16_t fetch(void) {
     uint16_t instruction = memory[pc] << 8 | memory[pc + 1];
+    COVER(chip8_coverage_exec, pc);
     pc += 2;
     return instruction;
 }
 
-void decode_and_exec(uint16_t instruction, uint8_t key_input) {
+// Decode and execute an instruction with the quirks `quirks`. Always inlined into
+// the specialised variants below, so the quirk checks are resolved at compile time.
+static ALWAYS_INLINE void decode_and_exec_quirks(uint16_t instruction, uint8_t key_input, const uint8_t quirks) {
     uint8_t unrecognised = 0;
 
     uint8_t first_nibble = (instruction & 0xF000) >> 12;
@@ -200,8 +449,6 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
     // display
     uint16_t dx;  // base col
     uint16_t dy;  // base row
-    uint16_t dr;  // iter row
-    uint16_t dc;  // iter col
     uint16_t di;  // buffer index
     // super display scrolling
     uint8_t scroll_scale;
@@ -210,12 +457,10 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
     // Intermediary result variable for logical and arithmetic operations.
     uint16_t op_intermediate;
 
-    FILE *rpl_f;
-
     switch (first_nibble) {
         case 0x0:
             // Double scrolling iff in low res and modern mode scrolling is on
-            scroll_scale = chip8_quirk_flag & CHIP8_QUIRK_SUPER_LEGACY_SCROLL;
+            scroll_scale = quirks & CHIP8_QUIRK_SUPER_LEGACY_SCROLL;
             scroll_scale = 1 << (low_res_mode * (scroll_scale == 0));
 
             switch (instruction) {
@@ -382,7 +627,7 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
                 
                 // 8XY6: Right shift. VX = VY >> 1 (modern: VX = VX >> 1)
                 case 0x6:
-                    if (CHIP8_QUIRK_LEGACY_SHIFT & chip8_quirk_flag) {
+                    if (CHIP8_QUIRK_LEGACY_SHIFT & quirks) {
                         V[X] = V[Y]; // Ambiguous
                     }
                     op_intermediate = V[X];
@@ -403,7 +648,7 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
                 
                 // 8XYE: Left shift. VX = VY << 1 (modern: VX = VX << 1)
                 case 0xE:
-                    if (CHIP8_QUIRK_LEGACY_SHIFT & chip8_quirk_flag) {
+                    if (CHIP8_QUIRK_LEGACY_SHIFT & quirks) {
                         V[X] = V[Y]; // Ambiguous
                     }
                     op_intermediate = V[X];
@@ -430,7 +675,7 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
 
         // BNNN: jump PC to V0 + NNN (ambiguous, modern BXNN: PC = VX + XNN)
         case 0xB:
-            if (CHIP8_QUIRK_LEGACY_JUMP_V0_OFFSET & chip8_quirk_flag) {
+            if (CHIP8_QUIRK_LEGACY_JUMP_V0_OFFSET & quirks) {
                 pc = V[0x0];
             } else {
                 pc = V[X];
@@ -440,7 +685,7 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
 
         // CXNN: store random number (ANDed with NN) in VX
         case 0xC:
-            V[X] = (rand() & NN);
+            V[X] = (random_byte() & NN);
             break;
         
         // DXYN: display
@@ -448,33 +693,8 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
             // The display positions should wrap. The sprite itself should not.
             dx = V[X] % (DISPLAY_RES_X >> low_res_mode);
             dy = V[Y] % (DISPLAY_RES_Y >> low_res_mode);
-            V[0xF] = 0;
+            V[0xF] = draw_kernels[low_res_mode](dx, dy, N);
             chip8_display_updated = 1;
-
-            for (dr = 0; dr < N && dy + dr < (DISPLAY_RES_Y >> low_res_mode); dr++) {
-                uint8_t sprite_data = memory[I + dr];
-                for (dc = 0; dc < 8 && dx + dc < (DISPLAY_RES_X >> low_res_mode); dc++) {
-                    // Check each bit in a left to right order
-                    if ((sprite_data & (0b10000000 >> dc)) != 0) {
-                        di = (((dy + dr) * DISPLAY_RES_X) + dx + dc);
-                        di = di << low_res_mode;
-
-                        // Sum the number of on bits being flipped
-                        V[0xF] += chip8_display[di];
-                        // Flip the display pixels bit
-                        chip8_display[di] ^= 1;
-                        if (low_res_mode) {  // low res compat drawing
-                            chip8_display[di + 1] ^= 1;
-                            chip8_display[di + DISPLAY_RES_X] ^= 1;
-                            chip8_display[di + DISPLAY_RES_X + 1] ^= 1;
-                        }
-                    }
-                }
-            }
-            if (low_res_mode) {
-                // constrain to 0 or 1 in low res mode
-                V[0xF] = V[0xF] > 0;
-            }
             break;
 
         case 0xE:
@@ -551,17 +771,17 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
 
                 // FX33: Binary-coded decimal conversion. Lay out digits starting at I
                 case 0x33:
-                    memory[I]     = V[X] / 100 % 10;
-                    memory[I + 1] = V[X] / 10 % 10; 
-                    memory[I + 2] = V[X] % 10;
+                    chip8_mem_write(I,     V[X] / 100 % 10);
+                    chip8_mem_write(I + 1, V[X] / 10 % 10);
+                    chip8_mem_write(I + 2, V[X] % 10);
                     break;
                 
                 // FX55: Store first n (determined by X) register values in memory
                 case 0x55:
                     for (int i = 0; i <= X; i++) {
-                        memory[I + i] = V[i];
+                        chip8_mem_write(I + i, V[i]);
                     }
-                    if (CHIP8_QUIRK_LEGACY_REG_DUMP_I & chip8_quirk_flag) {
+                    if (CHIP8_QUIRK_LEGACY_REG_DUMP_I & quirks) {
                         I += X + 1; // Ambiguous: old ROMS expect this
                     }
                     break;
@@ -570,28 +790,32 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
                 case 0x65:
                     for (int i = 0; i <= X; i++) {
                         V[i] = memory[I + i];
+                        COVER(chip8_coverage_read, I + i);
                     }
-                    if (CHIP8_QUIRK_LEGACY_REG_DUMP_I & chip8_quirk_flag) {
+                    if (CHIP8_QUIRK_LEGACY_REG_DUMP_I & quirks) {
                         I += X + 1;  // Ambiguous: old ROMS expect this
                     }
                     break;
 
-                // FX75 (SUPER-CHIP 1.0): Store V0..VX in RPL user flags  TODO
+                // FX75 (SUPER-CHIP 1.0): Store V0..VX in RPL user flags
                 case 0x75:
-                    rpl_f = fopen(SUPER_CHIP_RPL_FILE, "wb");
-                    for (int i = 0; i <= X && i <= 7; i++) {
-                        fwrite(&V[i], sizeof(uint8_t), 1, rpl_f);
+                    if (!rpl_flags_loaded) {
+                        load_rpl_flags();  // keep flags above X intact
+                    }
+                    for (int i = 0; i <= X && i < NUM_RPL_FLAGS; i++) {
+                        rpl_flags[i] = V[i];
                     }
-                    fclose(rpl_f);
+                    rpl_flags_dirty = 1;
                     break;
 
-                // FX85 (SUPER-CHIP 1.0): Read V0..VX from RPL user flags  TODO
+                // FX85 (SUPER-CHIP 1.0): Read V0..VX from RPL user flags
                 case 0x85:
-                    rpl_f = fopen(SUPER_CHIP_RPL_FILE, "rb");
-                    for (int i = 0; i <= X && i <= 7; i++) {
-                        fread(&V[i], sizeof(uint8_t), 1, rpl_f);
+                    if (!rpl_flags_loaded) {
+                        load_rpl_flags();
+                    }
+                    for (int i = 0; i <= X && i < NUM_RPL_FLAGS; i++) {
+                        V[i] = rpl_flags[i];
                     }
-                    fclose(rpl_f);
                     break;
 
                 default:
@@ -603,12 +827,137 @@ void decode_and_exec(uint16_t instruction, uint8_t key_input) {
             unrecognised = 1;
     }
     if (unrecognised) {
-        printf("[INFO] decode_and_exec: Unrecognised instruction '%04x'\n", instruction);
+        logger_unrecognised(instruction, pc - 2);
+    }
+}
+
+// One decode_and_exec specialised for each combination of CHIP8_QUIRK_* bits
+#define DECODE_AND_EXEC_VARIANT(quirks) \
+    void decode_and_exec_##quirks(uint16_t instruction, uint8_t key_input) { \
+        decode_and_exec_quirks(instruction, key_input, quirks); \
     }
+
+DECODE_AND_EXEC_VARIANT(0)
+DECODE_AND_EXEC_VARIANT(1)
+DECODE_AND_EXEC_VARIANT(2)
+DECODE_AND_EXEC_VARIANT(3)
+DECODE_AND_EXEC_VARIANT(4)
+DECODE_AND_EXEC_VARIANT(5)
+DECODE_AND_EXEC_VARIANT(6)
+DECODE_AND_EXEC_VARIANT(7)
+DECODE_AND_EXEC_VARIANT(8)
+DECODE_AND_EXEC_VARIANT(9)
+DECODE_AND_EXEC_VARIANT(10)
+DECODE_AND_EXEC_VARIANT(11)
+DECODE_AND_EXEC_VARIANT(12)
+DECODE_AND_EXEC_VARIANT(13)
+DECODE_AND_EXEC_VARIANT(14)
+DECODE_AND_EXEC_VARIANT(15)
+
+void (*const decode_and_exec_variants[CHIP8_QUIRK_LEGACY_MODE + 1])(uint16_t, uint8_t) = {
+    decode_and_exec_0,  decode_and_exec_1,  decode_and_exec_2,  decode_and_exec_3,
+    decode_and_exec_4,  decode_and_exec_5,  decode_and_exec_6,  decode_and_exec_7,
+    decode_and_exec_8,  decode_and_exec_9,  decode_and_exec_10, decode_and_exec_11,
+    decode_and_exec_12, decode_and_exec_13, decode_and_exec_14, decode_and_exec_15,
+};
+
+// Variant used by `chip8_step`, chosen by `chip8_select_quirks` when the quirks change
+void (*decode_and_exec_selected)(uint16_t, uint8_t);
+
+void chip8_select_quirks(void) {
+    decode_and_exec_selected = decode_and_exec_variants[chip8_quirk_flag & CHIP8_QUIRK_LEGACY_MODE];
+}
+
+// Execute an instruction with the variant for the current `chip8_quirk_flag`,
+// looked up per call, for use outside `chip8_step` (e.g. benchmarks).
+void decode_and_exec(uint16_t instruction, uint8_t key_input) {
+    decode_and_exec_variants[chip8_quirk_flag & CHIP8_QUIRK_LEGACY_MODE](instruction, key_input);
+}
+
+uint8_t chip8_op_class(uint16_t instruction) {
+    uint8_t NN = instruction & 0x00FF;
+
+    switch (instruction >> 12) {
+        case 0x0:
+            switch (instruction) {
+                case 0x00E0: return OP_00E0;
+                case 0x00EE: return OP_00EE;
+                case 0x00FB: return OP_00FB;
+                case 0x00FC: return OP_00FC;
+                case 0x00FD: return OP_00FD;
+                case 0x00FE: return OP_00FE;
+                case 0x00FF: return OP_00FF;
+            }
+            return (instruction & 0xFFF0) == 0x00C0 ? OP_00CN : OP_UNRECOGNISED;
+        case 0x1: return OP_1NNN;
+        case 0x2: return OP_2NNN;
+        case 0x3: return OP_3XNN;
+        case 0x4: return OP_4XNN;
+        case 0x5: return OP_5XY0;
+        case 0x6: return OP_6XNN;
+        case 0x7: return OP_7XNN;
+        case 0x8:
+            switch (instruction & 0x000F) {
+                case 0x0: return OP_8XY0;
+                case 0x1: return OP_8XY1;
+                case 0x2: return OP_8XY2;
+                case 0x3: return OP_8XY3;
+                case 0x4: return OP_8XY4;
+                case 0x5: return OP_8XY5;
+                case 0x6: return OP_8XY6;
+                case 0x7: return OP_8XY7;
+                case 0xE: return OP_8XYE;
+            }
+            return OP_UNRECOGNISED;
+        case 0x9: return OP_9XY0;
+        case 0xA: return OP_ANNN;
+        case 0xB: return OP_BNNN;
+        case 0xC: return OP_CXNN;
+        case 0xD: return OP_DXYN;
+        case 0xE:
+            switch (NN) {
+                case 0x9E: return OP_EX9E;
+                case 0xA1: return OP_EXA1;
+            }
+            return OP_UNRECOGNISED;
+        case 0xF:
+            switch (NN) {
+                case 0x07: return OP_FX07;
+                case 0x0A: return OP_FX0A;
+                case 0x15: return OP_FX15;
+                case 0x18: return OP_FX18;
+                case 0x1E: return OP_FX1E;
+                case 0x29: return OP_FX29;
+                case 0x30: return OP_FX30;
+                case 0x33: return OP_FX33;
+                case 0x55: return OP_FX55;
+                case 0x65: return OP_FX65;
+                case 0x75: return OP_FX75;
+                case 0x85: return OP_FX85;
+            }
+            return OP_UNRECOGNISED;
+    }
+    return OP_UNRECOGNISED;
+}
+
+const char *chip8_op_class_name(uint8_t op_class) {
+    static const char *names[NUM_OP_CLASSES] = {
+        "00E0", "00EE", "00CN", "00FB", "00FC", "00FD", "00FE", "00FF",
+        "1NNN", "2NNN", "3XNN", "4XNN", "5XY0", "6XNN", "7XNN",
+        "8XY0", "8XY1", "8XY2", "8XY3", "8XY4", "8XY5", "8XY6", "8XY7", "8XYE",
+        "9XY0", "ANNN", "BNNN", "CXNN", "DXYN",
+        "EX9E", "EXA1",
+        "FX07", "FX0A", "FX15", "FX18", "FX1E", "FX29", "FX30", "FX33",
+        "FX55", "FX65", "FX75", "FX85",
+        "????"
+    };
+    if (op_class >= NUM_OP_CLASSES) {
+        return names[OP_UNRECOGNISED];
+    }
+    return names[op_class];
 }
 
-#ifdef DEBUG
-void chip8_print_state() {
+void chip8_print_state(void) {
     printf("* Registers\n");
     printf("V0: %02x, V1: %02x, V2: %02x, V3: %02x\n", V[0], V[1], V[2], V[3]);
     printf("V4: %02x, V5: %02x, V6: %02x, V7: %02x\n", V[4], V[5], V[6], V[7]);
@@ -631,34 +980,48 @@ void chip8_print_state() {
 }
 
 void chip8_print_memory(uint16_t addr, uint16_t range) {
-    u_int16_t i;
+    uint16_t i;
     printf("* Memory [0x%03x...0x%03x]", addr, addr + range);
     for (i = addr; i < addr + range; i++) {
         if (i % 4 == 0) {
             printf("\n");
         }
-        printf("%x: %02x ", i, memory[i]);
+        printf("%x: %02x ", i, memory[i % TOTAL_MEMORY]);
     }
     printf("\n");
 }
 
 void chip8_print_next_op(void) {
-    printf("op: %04x at addr %03x\n", memory[pc] << 8 | memory[pc + 1], pc);
+    char assembly[CHIP8_DISASSEMBLY_LEN];
+    uint16_t instruction = memory[pc % TOTAL_MEMORY] << 8 | memory[(pc + 1) % TOTAL_MEMORY];
+
+    chip8_disassemble(instruction, assembly);
+    printf("op: %04x (%s) at addr %03x\n", instruction, assembly, pc);
+}
+
+uint16_t chip8_pc(void) {
+    return pc;
 }
-#endif  // DEBUG
 
 void chip8_init(void) {
     pc = PROG_START_ADDR;
+    step_pc = PROG_START_ADDR;
     I  = 0;
     sp = 0;
+    random_state = RANDOM_SEED;
 
     delay_timer = 0;
     sound_timer = 0;
+    chip8_cycles = 0;
 
     memset(memory,        0, TOTAL_MEMORY);
     memset(chip8_display, 0, DISPLAY_RES_X * DISPLAY_RES_Y);
     memset(stack,         0, STACK_SIZE);
     memset(V,             0, NUM_GP_REGISTERS);
+    memset(chip8_coverage_exec,  0, CHIP8_COVERAGE_BYTES);
+    memset(chip8_coverage_read,  0, CHIP8_COVERAGE_BYTES);
+    memset(chip8_coverage_write, 0, CHIP8_COVERAGE_BYTES);
+    chip8_rom_size = 0;
 
     for (unsigned long i = 0; i < sizeof(fonts); i++) {
         memory[FONT_START_ADDR + i] = fonts[i];
@@ -670,16 +1033,35 @@ void chip8_init(void) {
     // Default quirks
     chip8_quirk_flag = CHIP8_QUIRK_LEGACY_MODE;
     // chip8_quirk_flag = CHIP8_QUIRK_MODERN_MODE;
+    chip8_select_quirks();
 
     // SUPER-CHIP 1.0
     low_res_mode = 1;
     chip8_exit_flag = 0;
+    memset(rpl_flags, 0, NUM_RPL_FLAGS);
+    rpl_flags_loaded = 0;
+    rpl_flags_dirty = 0;
+    rom_hash = FNV_OFFSET_BASIS;
 
     // Can't find any documentation stating where to place 16x16 fonts.
     // Just going to place immediately after regular fonts.
     for (unsigned long i = 0; i < sizeof(super_fonts); i++) {
         memory[SFONT_START_ADDR + i] = super_fonts[i];
     }
+    memory_changed(0, TOTAL_MEMORY);
+
+    for (int byte = 0; byte < 256; byte++) {
+        uint8_t pixels[8];
+
+        double_bits[byte] = 0;
+        for (int bit = 0; bit < 8; bit++) {
+            pixels[bit] = (byte >> (7 - bit)) & 1;
+            if (pixels[bit]) {
+                double_bits[byte] |= 0xC000 >> (2 * bit);
+            }
+        }
+        memcpy(&expand_bits[byte], pixels, sizeof(pixels));
+    }
 }
 
 uint8_t chip8_load_rom(const char *rom_path) {
@@ -711,18 +1093,177 @@ uint8_t chip8_load_rom(const char *rom_path) {
     }
 
     // Copy read bytes to chip-8 memory
+    rom_hash = FNV_OFFSET_BASIS;
     for (int i = 0; i < file_bytes; i++) {
         memory[PROG_START_ADDR + i] = buffer[i];
+        rom_hash = (rom_hash ^ buffer[i]) * FNV_PRIME;
+    }
+    chip8_rom_size = file_bytes;
+    if (file_bytes) {
+        memory_changed(PROG_START_ADDR, file_bytes);
     }
 
     fclose(f);
     return 0;
 }
 
+// Execute an instruction, reporting what changed to `chip8_trace_hook`.
+void traced_decode_and_exec(uint16_t instruction, uint8_t key_input) {
+    struct chip8_trace_record record;
+    uint64_t V_before[NUM_GP_REGISTERS / 8];  // compared as words, not with memcmp
+    uint64_t V_after[NUM_GP_REGISTERS / 8];
+
+    record.cycle = chip8_cycles;
+    record.pc = pc - 2;
+    record.instruction = instruction;
+    memcpy(V_before, V, NUM_GP_REGISTERS);
+
+    (*decode_and_exec_selected)(instruction, key_input);
+
+    record.I = I;
+    record.reg = CHIP8_TRACE_NO_REG;
+    record.value = 0;
+    memcpy(V_after, V, NUM_GP_REGISTERS);
+    if ((V_before[0] ^ V_after[0]) | (V_before[1] ^ V_after[1])) {
+        for (uint8_t i = 0; i < NUM_GP_REGISTERS; i++) {
+            if (V[i] != ((uint8_t *) V_before)[i]) {
+                record.reg = i;
+                record.value = V[i];
+                break;
+            }
+        }
+    }
+    (*chip8_trace_hook)(&record);
+}
+
 void chip8_step(uint8_t key_input, double time_sec) {
     update_timers(time_sec);
+    step_pc = pc;
     uint16_t instruction = fetch();
-    decode_and_exec(instruction, key_input);
+    PROFILE_BEGIN(pc - 2);
+    if (chip8_trace_hook) {
+        traced_decode_and_exec(instruction, key_input);
+    } else {
+        (*decode_and_exec_selected)(instruction, key_input);
+    }
+    PROFILE_END(instruction);
+    chip8_cycles++;
+}
+
+void chip8_disassemble(uint16_t instruction, char *buffer) {
+    uint16_t NNN = instruction & 0x0FFF;
+    uint8_t NN = instruction & 0x00FF;
+    uint8_t N = instruction & 0x000F;
+    uint8_t X = (instruction & 0x0F00) >> 8;
+    uint8_t Y = (instruction & 0x00F0) >> 4;
+
+    switch (chip8_op_class(instruction)) {
+        case OP_00E0: sprintf(buffer, "CLS"); break;
+        case OP_00EE: sprintf(buffer, "RET"); break;
+        case OP_00CN: sprintf(buffer, "SCD %u", N); break;
+        case OP_00FB: sprintf(buffer, "SCR"); break;
+        case OP_00FC: sprintf(buffer, "SCL"); break;
+        case OP_00FD: sprintf(buffer, "EXIT"); break;
+        case OP_00FE: sprintf(buffer, "LOW"); break;
+        case OP_00FF: sprintf(buffer, "HIGH"); break;
+        case OP_1NNN: sprintf(buffer, "JP %03X", NNN); break;
+        case OP_2NNN: sprintf(buffer, "CALL %03X", NNN); break;
+        case OP_3XNN: sprintf(buffer, "SE V%X, %02X", X, NN); break;
+        case OP_4XNN: sprintf(buffer, "SNE V%X, %02X", X, NN); break;
+        case OP_5XY0: sprintf(buffer, "SE V%X, V%X", X, Y); break;
+        case OP_6XNN: sprintf(buffer, "LD V%X, %02X", X, NN); break;
+        case OP_7XNN: sprintf(buffer, "ADD V%X, %02X", X, NN); break;
+        case OP_8XY0: sprintf(buffer, "LD V%X, V%X", X, Y); break;
+        case OP_8XY1: sprintf(buffer, "OR V%X, V%X", X, Y); break;
+        case OP_8XY2: sprintf(buffer, "AND V%X, V%X", X, Y); break;
+        case OP_8XY3: sprintf(buffer, "XOR V%X, V%X", X, Y); break;
+        case OP_8XY4: sprintf(buffer, "ADD V%X, V%X", X, Y); break;
+        case OP_8XY5: sprintf(buffer, "SUB V%X, V%X", X, Y); break;
+        case OP_8XY6: sprintf(buffer, "SHR V%X, V%X", X, Y); break;
+        case OP_8XY7: sprintf(buffer, "SUBN V%X, V%X", X, Y); break;
+        case OP_8XYE: sprintf(buffer, "SHL V%X, V%X", X, Y); break;
+        case OP_9XY0: sprintf(buffer, "SNE V%X, V%X", X, Y); break;
+        case OP_ANNN: sprintf(buffer, "LD I, %03X", NNN); break;
+        case OP_BNNN: sprintf(buffer, "JP V0, %03X", NNN); break;
+        case OP_CXNN: sprintf(buffer, "RND V%X, %02X", X, NN); break;
+        case OP_DXYN: sprintf(buffer, "DRW V%X, V%X, %u", X, Y, N); break;
+        case OP_EX9E: sprintf(buffer, "SKP V%X", X); break;
+        case OP_EXA1: sprintf(buffer, "SKNP V%X", X); break;
+        case OP_FX07: sprintf(buffer, "LD V%X, DT", X); break;
+        case OP_FX0A: sprintf(buffer, "LD V%X, K", X); break;
+        case OP_FX15: sprintf(buffer, "LD DT, V%X", X); break;
+        case OP_FX18: sprintf(buffer, "LD ST, V%X", X); break;
+        case OP_FX1E: sprintf(buffer, "ADD I, V%X", X); break;
+        case OP_FX29: sprintf(buffer, "LD F, V%X", X); break;
+        case OP_FX30: sprintf(buffer, "LD HF, V%X", X); break;
+        case OP_FX33: sprintf(buffer, "LD B, V%X", X); break;
+        case OP_FX55: sprintf(buffer, "LD [I], V%X", X); break;
+        case OP_FX65: sprintf(buffer, "LD V%X, [I]", X); break;
+        case OP_FX75: sprintf(buffer, "LD R, V%X", X); break;
+        case OP_FX85: sprintf(buffer, "LD V%X, R", X); break;
+        default:      sprintf(buffer, "DW %04X", instruction); break;
+    }
+}
+
+void chip8_memory_read(uint16_t addr, uint8_t *buffer, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        buffer[i] = memory[(addr + i) % TOTAL_MEMORY];
+    }
+}
+
+uint32_t chip8_sample(void) {
+    uint16_t addr = step_pc % TOTAL_MEMORY;
+
+    return (uint32_t) addr << 16 | memory[addr] << 8 | memory[(addr + 1) % TOTAL_MEMORY];
+}
+
+uint8_t chip8_call_stack(uint16_t *frames) {
+    uint16_t call;
+
+    for (uint16_t i = 0; i < sp; i++) {
+        // The return address follows the 2NNN that made the call
+        call = memory[(stack[i] - 2) % TOTAL_MEMORY] << 8 | memory[(stack[i] - 1) % TOTAL_MEMORY];
+        frames[i] = (call & 0xF000) == 0x2000 ? call & 0x0FFF : stack[i];
+    }
+    frames[sp] = pc;
+    return sp + 1;
+}
+
+uint64_t chip8_display_hash(const uint8_t *display) {
+    // Four independent multiply-xor lanes over 8 pixels per word, so the
+    // multiplies overlap rather than each waiting on the last
+    uint64_t lanes[DISPLAY_HASH_LANES] = {1, 2, 3, 4};
+    uint64_t words[DISPLAY_HASH_LANES];
+    uint64_t hash = 0;
+
+    for (uint16_t i = 0; i < DISPLAY_RES_X * DISPLAY_RES_Y; i += sizeof(words)) {
+        memcpy(words, &display[i], sizeof(words));
+        for (uint8_t lane = 0; lane < DISPLAY_HASH_LANES; lane++) {
+            lanes[lane] = (lanes[lane] ^ words[lane]) * DISPLAY_HASH_PRIME;
+        }
+    }
+    for (uint8_t lane = 0; lane < DISPLAY_HASH_LANES; lane++) {
+        hash = (hash ^ lanes[lane] ^ lanes[lane] >> 29) * DISPLAY_HASH_PRIME;
+    }
+    return hash ^ hash >> 32;
+}
+
+void chip8_flush_rpl_flags(void) {
+    char file_name[SUPER_CHIP_RPL_FILE_LEN];
+    FILE *f;
+
+    if (!rpl_flags_dirty) {
+        return;
+    }
+    rpl_flags_file_name(file_name);
+    f = fopen(file_name, "wb");
+    if (!f) {
+        fprintf(stderr, "chip8_flush_rpl_flags: Failed to open '%s'\n", file_name);
+        return;
+    }
+    fwrite(rpl_flags, sizeof(uint8_t), NUM_RPL_FLAGS, f);
+    fclose(f);
+    rpl_flags_dirty = 0;
 }
 
 void chip8_write_state(void) {
@@ -770,6 +1311,7 @@ void chip8_write_state(void) {
 }
 
 void chip8_load_state(void) {
+    uint8_t new_memory[TOTAL_MEMORY];
     FILE *f;
     int i;
 
@@ -787,12 +1329,14 @@ void chip8_load_state(void) {
     fread(&chip8_sound_off,  sizeof(uint8_t), 1, f);
     fread(&chip8_exit_flag,  sizeof(uint8_t), 1, f);
     fread(&chip8_quirk_flag, sizeof(uint8_t), 1, f);
+    chip8_select_quirks();
     fread(&chip8_next_timer_update, sizeof(double), 1, f);
 
     // Read internal state
     for (i = 0; i < TOTAL_MEMORY; i++) {
-        fread(&memory[i], sizeof(uint8_t), 1, f);
+        fread(&new_memory[i], sizeof(uint8_t), 1, f);
     }
+    memory_load(new_memory);
     for (i = 0; i < NUM_GP_REGISTERS; i++) {
         fread(&V[i], sizeof(uint8_t), 1, f);
     }
@@ -813,4 +1357,63 @@ void chip8_load_state(void) {
     fclose(f);
 
     chip8_display_updated = 1;
-}
\ No newline at end of file
+}
+
+void chip8_snapshot(uint8_t *buffer) {
+    uint8_t *b = buffer;
+
+    memcpy(b, chip8_display, DISPLAY_RES_X * DISPLAY_RES_Y);
+    b += DISPLAY_RES_X * DISPLAY_RES_Y;
+    memcpy(b, memory, TOTAL_MEMORY);
+    b += TOTAL_MEMORY;
+    memcpy(b, V, NUM_GP_REGISTERS);
+    b += NUM_GP_REGISTERS;
+    memcpy(b, &pc, sizeof(uint16_t));
+    b += sizeof(uint16_t);
+    memcpy(b, &I, sizeof(uint16_t));
+    b += sizeof(uint16_t);
+    memcpy(b, stack, sizeof(stack));
+    b += sizeof(stack);
+    memcpy(b, &sp, sizeof(uint16_t));
+    b += sizeof(uint16_t);
+    memcpy(b, &random_state, sizeof(uint32_t));
+    b += sizeof(uint32_t);
+
+    *b++ = delay_timer;
+    *b++ = sound_timer;
+    *b++ = low_res_mode;
+    *b++ = chip8_quirk_flag;
+    *b++ = chip8_sound_off;
+    *b++ = chip8_exit_flag;
+}
+
+void chip8_restore(const uint8_t *buffer) {
+    const uint8_t *b = buffer;
+
+    memcpy(chip8_display, b, DISPLAY_RES_X * DISPLAY_RES_Y);
+    b += DISPLAY_RES_X * DISPLAY_RES_Y;
+    memory_load(b);
+    b += TOTAL_MEMORY;
+    memcpy(V, b, NUM_GP_REGISTERS);
+    b += NUM_GP_REGISTERS;
+    memcpy(&pc, b, sizeof(uint16_t));
+    b += sizeof(uint16_t);
+    memcpy(&I, b, sizeof(uint16_t));
+    b += sizeof(uint16_t);
+    memcpy(stack, b, sizeof(stack));
+    b += sizeof(stack);
+    memcpy(&sp, b, sizeof(uint16_t));
+    b += sizeof(uint16_t);
+    memcpy(&random_state, b, sizeof(uint32_t));
+    b += sizeof(uint32_t);
+
+    delay_timer      = *b++;
+    sound_timer      = *b++;
+    low_res_mode     = *b++;
+    chip8_quirk_flag = *b++;
+    chip8_sound_off  = *b++;
+    chip8_exit_flag  = *b++;
+    chip8_select_quirks();
+
+    chip8_display_updated = 1;
+}
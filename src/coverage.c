@@ -0,0 +1,101 @@
+#include <stdio.h>
+
+#include "chip8.h"
+#include "coverage.h"
+
+#define COVERAGE_ADDR_SPACE 0x1000
+#define COVERAGE_ROM_START 0x200
+
+uint16_t coverage_count(const uint8_t *bitmap, uint16_t start, uint16_t end) {
+    uint16_t count = 0;
+
+    for (uint16_t addr = start; addr < end; addr++) {
+        count += CHIP8_COVERED(bitmap, addr);
+    }
+    return count;
+}
+
+// Any byte of [addr, addr + len) covered
+uint8_t coverage_any(const uint8_t *bitmap, uint16_t addr, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        if (CHIP8_COVERED(bitmap, addr + i)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// One line per instruction, or per byte where an instruction starts on the next byte.
+// Returns the number of bytes the line covers.
+uint8_t coverage_write_line(FILE *f, uint16_t addr) {
+    char assembly[CHIP8_DISASSEMBLY_LEN];
+    uint8_t data[2];
+    uint8_t len = 2;
+
+    chip8_memory_read(addr, data, 2);
+    if (!CHIP8_COVERED(chip8_coverage_exec, addr) && CHIP8_COVERED(chip8_coverage_exec, addr + 1)) {
+        len = 1;
+        sprintf(assembly, "DB %02X", data[0]);
+        fprintf(f, "%03x  %02x    ", addr, data[0]);
+    } else {
+        chip8_disassemble(data[0] << 8 | data[1], assembly);
+        fprintf(f, "%03x  %02x%02x  ", addr, data[0], data[1]);
+    }
+    fprintf(f, "%c%c%c  %s\n",
+        CHIP8_COVERED(chip8_coverage_exec, addr) ? 'X' : '.',
+        coverage_any(chip8_coverage_read, addr, len) ? 'R' : '.',
+        coverage_any(chip8_coverage_write, addr, len) ? 'W' : '.',
+        assembly);
+    return len;
+}
+
+uint8_t coverage_write(const char *path) {
+    uint16_t rom_end = COVERAGE_ROM_START + chip8_rom_size;
+    uint16_t executed = coverage_count(chip8_coverage_exec, COVERAGE_ROM_START, rom_end);
+    uint16_t untouched = 0;
+    uint8_t outside = 0;
+    uint16_t addr;
+    FILE *f;
+
+    f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "coverage_write: Failed to open '%s'\n", path);
+        return 1;
+    }
+
+    for (addr = COVERAGE_ROM_START; addr < rom_end; addr++) {
+        untouched += !coverage_any(chip8_coverage_exec, addr & ~1, 2) && !CHIP8_COVERED(chip8_coverage_read, addr)
+            && !CHIP8_COVERED(chip8_coverage_write, addr);
+    }
+    fprintf(f, "* ROM %03x-%03x (%u bytes)\n", COVERAGE_ROM_START, rom_end, chip8_rom_size);
+    fprintf(f, "executed:  %u instructions (%.1f%% of ROM)\n", executed,
+        chip8_rom_size ? 200.0 * executed / chip8_rom_size : 0.0);
+    fprintf(f, "read:      %u bytes (%u in ROM)\n", coverage_count(chip8_coverage_read, 0, COVERAGE_ADDR_SPACE),
+        coverage_count(chip8_coverage_read, COVERAGE_ROM_START, rom_end));
+    fprintf(f, "written:   %u bytes (%u in ROM)\n", coverage_count(chip8_coverage_write, 0, COVERAGE_ADDR_SPACE),
+        coverage_count(chip8_coverage_write, COVERAGE_ROM_START, rom_end));
+    fprintf(f, "untouched: %u bytes of ROM\n", untouched);
+
+    fprintf(f, "\naddr data  XRW  assembly\n");
+    for (addr = COVERAGE_ROM_START; addr < rom_end;) {
+        addr += coverage_write_line(f, addr);
+    }
+
+    // Code run from outside the ROM, e.g. generated at runtime
+    for (addr = 0; addr < COVERAGE_ADDR_SPACE;) {
+        if ((addr >= COVERAGE_ROM_START && addr < rom_end) || !CHIP8_COVERED(chip8_coverage_exec, addr)) {
+            addr++;
+            continue;
+        }
+        if (!outside) {
+            fprintf(f, "\n* Executed outside of ROM\n");
+            outside = 1;
+        }
+        addr += coverage_write_line(f, addr);
+    }
+    fclose(f);
+
+    printf("* Coverage: %u instructions executed, %u ROM bytes untouched, written to '%s'\n",
+        executed, untouched, path);
+    return 0;
+}
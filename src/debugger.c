@@ -0,0 +1,397 @@
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "chip8.h"
+#include "debugger.h"
+
+#define DEBUGGER_ADDR_SPACE 0x1000
+#define DEBUGGER_LOG_MASK (DEBUGGER_LOG_SIZE - 1)
+
+struct debugger_keyframe {
+    uint64_t cycle;
+    uint8_t state[CHIP8_SNAPSHOT_SIZE];
+};
+
+uint8_t debugger_stopped;
+unsigned int debugger_steps_left;
+uint8_t debugger_watch_hit;
+uint16_t debugger_watch_addr;
+
+// Keyframe ring, oldest first from `debugger_keyframe_first`
+struct debugger_keyframe debugger_keyframes[DEBUGGER_MAX_KEYFRAMES];
+uint32_t debugger_keyframe_first;
+uint32_t debugger_keyframe_count;
+uint32_t debugger_keyframe_interval = DEBUGGER_KEYFRAME_INTERVAL;
+
+// Input of each executed instruction, indexed by cycle. Valid for
+// [debugger_log_end - DEBUGGER_LOG_SIZE, debugger_log_end).
+// Whether the timers ticked is logged rather than the time, so re-execution
+// does not depend on `chip8_next_timer_update`, which the caller may reset.
+uint8_t debugger_log_keys[DEBUGGER_LOG_SIZE];
+uint8_t debugger_log_ticks[DEBUGGER_LOG_SIZE];
+uint64_t debugger_log_end;
+uint8_t debugger_replaying;  // re-executed since last live instruction
+
+void debugger_print_keys(void) {
+    printf("Debug mode keys:\n");
+    printf("s         - step 1 instruction\n");
+    printf("s [n]     - step n (decimal) instructions\n");
+    printf("c         - continue until a breakpoint or watchpoint\n");
+    printf("b [a]     - toggle breakpoint at address a (hex)\n");
+    printf("w [a]     - toggle write watchpoint at address a (hex)\n");
+    printf("w [a] [l] - toggle write watchpoints at address a (hex), length l (hex)\n");
+    printf("l         - list breakpoints and watchpoints\n");
+    printf("rs        - reverse step 1 instruction\n");
+    printf("rs [n]    - reverse step n (decimal) instructions\n");
+    printf("rc        - reverse continue to the previous breakpoint or watchpoint\n");
+    printf("k [n]     - take reverse keyframes every n (decimal) instructions\n");
+    printf("i         - print chip8 state\n");
+    printf("m [a]     - print memory at address a (hex)\n");
+    printf("m [a] [l] - print memory at address a (hex), length l (hex)\n");
+    printf("n         - print next opcode/instruction\n");
+    printf("h         - print this list again\n");
+    printf("q         - quit\n");
+}
+
+void debugger_toggle_breakpoint(uint16_t addr) {
+    addr %= DEBUGGER_ADDR_SPACE;
+    debugger_breakpoints[addr >> 3] ^= 1 << (addr & 7);
+    printf("Breakpoint at %03x %s\n", addr, CHIP8_COVERED(debugger_breakpoints, addr) ? "set" : "cleared");
+}
+
+void debugger_toggle_watchpoint(uint16_t addr, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        uint16_t a = (addr + i) % DEBUGGER_ADDR_SPACE;
+        debugger_watchpoints[a >> 3] ^= 1 << (a & 7);
+    }
+    printf("Watchpoint at %03x (%u bytes) toggled\n", addr % DEBUGGER_ADDR_SPACE, len);
+}
+
+// Write observer, see `chip8_add_write_observer`
+void debugger_watch(uint16_t addr, uint16_t len) {
+    for (uint16_t i = 0; i < len; i++) {
+        if (CHIP8_COVERED(debugger_watchpoints, addr + i)) {
+            debugger_watch_hit = 1;
+            debugger_watch_addr = addr + i;
+            return;
+        }
+    }
+}
+
+void debugger_list(void) {
+    printf("Breakpoints:");
+    for (uint16_t addr = 0; addr < DEBUGGER_ADDR_SPACE; addr++) {
+        if (CHIP8_COVERED(debugger_breakpoints, addr)) {
+            printf(" %03x", addr);
+        }
+    }
+    printf("\nWatchpoints:");
+    for (uint16_t addr = 0; addr < DEBUGGER_ADDR_SPACE; addr++) {
+        if (CHIP8_COVERED(debugger_watchpoints, addr)) {
+            printf(" %03x", addr);
+        }
+    }
+    printf("\n");
+}
+
+void debugger_reset_history(void) {
+    debugger_keyframe_first = 0;
+    debugger_keyframe_count = 0;
+    debugger_log_end = chip8_cycles;
+    debugger_replaying = 0;
+    debugger_watch_hit = 0;  // pages rewritten by the restore, not by the guest
+}
+
+struct debugger_keyframe *debugger_keyframe(uint32_t i) {
+    return &debugger_keyframes[(debugger_keyframe_first + i) % DEBUGGER_MAX_KEYFRAMES];
+}
+
+// Keyframes older than the input log cannot be re-executed from
+uint8_t debugger_keyframe_usable(const struct debugger_keyframe *keyframe) {
+    return debugger_log_end <= DEBUGGER_LOG_SIZE || keyframe->cycle >= debugger_log_end - DEBUGGER_LOG_SIZE;
+}
+
+// Record the input of a live instruction, taking a keyframe first if due
+void debugger_record(uint8_t key_input, double time_sec) {
+    struct debugger_keyframe *keyframe;
+
+    if (chip8_cycles != debugger_log_end) {
+        debugger_reset_history();
+    }
+    if (!debugger_keyframe_count
+            || chip8_cycles - debugger_keyframe(debugger_keyframe_count - 1)->cycle >= debugger_keyframe_interval) {
+        if (debugger_keyframe_count == DEBUGGER_MAX_KEYFRAMES) {
+            debugger_keyframe_first = (debugger_keyframe_first + 1) % DEBUGGER_MAX_KEYFRAMES;
+            debugger_keyframe_count--;
+        }
+        keyframe = debugger_keyframe(debugger_keyframe_count++);
+        keyframe->cycle = chip8_cycles;
+        chip8_snapshot(keyframe->state);
+    }
+    debugger_log_keys[chip8_cycles & DEBUGGER_LOG_MASK] = key_input;
+    debugger_log_ticks[chip8_cycles & DEBUGGER_LOG_MASK] = time_sec > chip8_next_timer_update;
+    debugger_log_end = chip8_cycles + 1;
+}
+
+// Restore a keyframe, for re-execution with `debugger_replay_step`
+void debugger_restore_keyframe(const struct debugger_keyframe *keyframe) {
+    chip8_restore(keyframe->state);
+    chip8_cycles = keyframe->cycle;
+    debugger_watch_hit = 0;  // not a write by the guest
+}
+
+// Re-execute one logged instruction, without tracing it again
+void debugger_replay_step(void) {
+    void (*trace_hook)(const struct chip8_trace_record *) = chip8_trace_hook;
+    uint8_t tick = debugger_log_ticks[chip8_cycles & DEBUGGER_LOG_MASK];
+
+    chip8_trace_hook = NULL;
+    chip8_step(debugger_log_keys[chip8_cycles & DEBUGGER_LOG_MASK], tick ? INFINITY : -INFINITY);
+    chip8_trace_hook = trace_hook;
+}
+
+uint8_t debugger_seek(uint64_t target) {
+    struct debugger_keyframe *keyframe = NULL;
+
+    if (target > debugger_log_end) {
+        return 1;
+    }
+    for (uint32_t i = debugger_keyframe_count; i-- > 0;) {
+        if (debugger_keyframe(i)->cycle <= target) {
+            keyframe = debugger_keyframe(i);
+            break;
+        }
+    }
+    if (!keyframe || !debugger_keyframe_usable(keyframe)) {
+        return 1;
+    }
+
+    debugger_restore_keyframe(keyframe);
+    while (chip8_cycles < target) {
+        debugger_replay_step();
+    }
+    debugger_watch_hit = 0;
+    debugger_replaying = 1;  // `chip8_next_timer_update` is stale until live again
+    return 0;
+}
+
+// The oldest instruction that can be reversed to
+uint64_t debugger_history_start(void) {
+    for (uint32_t i = 0; i < debugger_keyframe_count; i++) {
+        if (debugger_keyframe_usable(debugger_keyframe(i))) {
+            return debugger_keyframe(i)->cycle;
+        }
+    }
+    return chip8_cycles;
+}
+
+void debugger_reverse_step(unsigned int steps) {
+    uint64_t start = debugger_history_start();
+    uint64_t target = chip8_cycles - start < steps ? start : chip8_cycles - steps;
+
+    if (target == chip8_cycles || debugger_seek(target) != 0) {
+        printf("No earlier history\n");
+        return;
+    }
+    if (chip8_cycles == start && steps > 1) {
+        printf("Reached the start of the history\n");
+    }
+    printf("Reversed to instruction %llu\n", (unsigned long long) chip8_cycles);
+}
+
+// Reverse to the latest breakpoint or watchpoint hit before the current
+// instruction, searching back one keyframe interval at a time.
+void debugger_reverse_continue(void) {
+    uint64_t end = chip8_cycles;
+    uint64_t hit;
+    uint8_t found;
+    struct debugger_keyframe *keyframe;
+
+    for (uint32_t i = debugger_keyframe_count; i-- > 0;) {
+        keyframe = debugger_keyframe(i);
+        if (keyframe->cycle >= end) {
+            continue;
+        }
+        if (!debugger_keyframe_usable(keyframe)) {
+            break;
+        }
+
+        found = 0;
+        hit = 0;
+        debugger_restore_keyframe(keyframe);
+        while (chip8_cycles < end) {
+            if (CHIP8_COVERED(debugger_breakpoints, chip8_pc())) {
+                hit = chip8_cycles;
+                found = 1;
+            }
+            debugger_replay_step();
+            if (debugger_watch_hit && chip8_cycles < end) {
+                debugger_watch_hit = 0;
+                hit = chip8_cycles;  // stop before the instruction after the write
+                found = 1;
+            }
+        }
+        debugger_watch_hit = 0;
+        if (found) {
+            debugger_seek(hit);
+            printf("Reversed to instruction %llu\n", (unsigned long long) chip8_cycles);
+            return;
+        }
+        end = keyframe->cycle;
+    }
+
+    debugger_seek(end);
+    printf("No earlier breakpoint or watchpoint, reversed to instruction %llu\n", (unsigned long long) chip8_cycles);
+}
+
+void debugger_init(void) {
+    if (!debugger_input) {
+        debugger_input = stdin;
+    }
+    debugger_stopped = 1;
+    debugger_steps_left = 0;
+    debugger_watch_hit = 0;
+    debugger_reset_history();
+    chip8_remove_write_observer(&debugger_watch);
+    chip8_add_write_observer(&debugger_watch);
+    debugger_print_keys();
+}
+
+// Read commands until one resumes execution. Returns non-zero to quit.
+uint8_t debugger_prompt(void) {
+    char buffer[DEBUGGER_LINE_LEN];
+    unsigned short mem_addr;
+    unsigned short mem_len;
+    unsigned int steps;
+
+    printf("Next ");
+    chip8_print_next_op();
+    for (;;) {
+        printf("> ");
+        fflush(stdout);
+        if (!fgets(buffer, DEBUGGER_LINE_LEN, debugger_input)) {
+            return 1;  // end of input
+        }
+        if (buffer[0] == 's') {
+            if (sscanf(buffer, "%*s %u", &steps) != 1 || steps == 0) {
+                steps = 1;
+            }
+            if (steps == 1) {
+                printf("Running 1 step\n");
+            } else {
+                printf("Running %u steps\n", steps);
+            }
+            debugger_steps_left = steps;
+            debugger_stopped = 0;
+            return 0;
+        }
+        else if (buffer[0] == 'r' && buffer[1] == 's') {
+            if (sscanf(buffer, "%*s %u", &steps) != 1 || steps == 0) {
+                steps = 1;
+            }
+            debugger_reverse_step(steps);
+            printf("Next ");
+            chip8_print_next_op();
+        }
+        else if (buffer[0] == 'r' && buffer[1] == 'c') {
+            debugger_reverse_continue();
+            printf("Next ");
+            chip8_print_next_op();
+        }
+        else if (buffer[0] == 'k') {
+            if (sscanf(buffer, "%*s %u", &steps) == 1 && steps > 0) {
+                debugger_keyframe_interval = steps;
+            }
+            printf("Keyframe every %u instructions\n", debugger_keyframe_interval);
+        }
+        else if (buffer[0] == 'c') {
+            debugger_stopped = 0;
+            return 0;
+        }
+        else if (buffer[0] == 'b') {
+            if (sscanf(buffer, "%*s %hx", &mem_addr) == 1) {
+                debugger_toggle_breakpoint(mem_addr);
+            } else {
+                printf("Usage: b [a]\n");
+            }
+        }
+        else if (buffer[0] == 'w') {
+            mem_len = 1;
+            if (sscanf(buffer, "%*s %hx %hx", &mem_addr, &mem_len) >= 1) {
+                debugger_toggle_watchpoint(mem_addr, mem_len);
+            } else {
+                printf("Usage: w [a] [l]\n");
+            }
+        }
+        else if (buffer[0] == 'l') {
+            debugger_list();
+        }
+        else if (buffer[0] == 'i') {
+            chip8_print_state();
+        }
+        else if (buffer[0] == 'm') {
+            mem_len = 1;
+            if (sscanf(buffer, "%*s %hx %hx", &mem_addr, &mem_len) >= 1) {
+                chip8_print_memory(mem_addr, mem_len);
+            }
+        }
+        else if (buffer[0] == 'n') {
+            printf("Next ");
+            chip8_print_next_op();
+        }
+        else if (buffer[0] == 'h') {
+            debugger_print_keys();
+        }
+        else if (buffer[0] == 'q') {
+            return 1;
+        } else {
+            printf("Invalid command.\n");
+        }
+    }
+}
+
+uint8_t debugger_step(uint8_t key_input, double time_sec) {
+    uint8_t prompted = 0;
+
+    // Fast path: running with no breakpoint at pc
+    if (debugger_stopped || debugger_steps_left || CHIP8_COVERED(debugger_breakpoints, chip8_pc())) {
+        if (!debugger_stopped && !debugger_steps_left) {
+            printf("Breakpoint at %03x\n", chip8_pc());
+            debugger_stopped = 1;
+        }
+        if (debugger_stopped) {
+            prompted = 1;
+            if (debugger_prompt() != 0) {
+                chip8_exit_flag = 1;
+                return prompted;
+            }
+        }
+        if (debugger_steps_left) {
+            printf("Running ");
+            chip8_print_next_op();
+            debugger_stopped = --debugger_steps_left == 0;
+        }
+    }
+
+    // Re-execute recorded history after reversing, otherwise record it
+    if (chip8_cycles < debugger_log_end) {
+        debugger_replay_step();
+    } else {
+        if (debugger_replaying) {
+            // Caught up, so timers continue from now rather than from the recorded time
+            chip8_next_timer_update = time_sec;
+            debugger_replaying = 0;
+        }
+        debugger_record(key_input, time_sec);
+        chip8_step(key_input, time_sec);
+    }
+
+    if (debugger_watch_hit) {
+        printf("Watchpoint: %03x written\n", debugger_watch_addr);
+        debugger_watch_hit = 0;
+        debugger_steps_left = 0;
+        debugger_stopped = 1;
+    }
+    return prompted;
+}
@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "logger.h"
+
+#define LOGGER_RING_MASK (LOGGER_RING_SIZE - 1)
+#define NUM_OPCODES 0x10000
+
+struct logger_record {
+    uint16_t instruction;
+    uint16_t addr;
+};
+
+struct logger_record logger_ring[LOGGER_RING_SIZE];
+uint32_t logger_head;  // next write, only advanced by `logger_unrecognised`
+uint32_t logger_tail;  // next read, only advanced by `logger_flush`
+uint32_t logger_suppressed;
+
+// Per instruction execution counts and the address it was first seen at
+uint32_t logger_counts[NUM_OPCODES];
+uint16_t logger_first_addr[NUM_OPCODES];
+
+void logger_init(void) {
+    logger_head = 0;
+    logger_tail = 0;
+    logger_suppressed = 0;
+    memset(logger_counts, 0, sizeof(logger_counts));
+}
+
+void logger_unrecognised(uint16_t instruction, uint16_t addr) {
+    if (logger_counts[instruction]++ == 0) {
+        logger_first_addr[instruction] = addr;
+    }
+    if (logger_head - logger_tail == LOGGER_RING_SIZE) {
+        logger_suppressed++;
+        return;
+    }
+    logger_ring[logger_head & LOGGER_RING_MASK].instruction = instruction;
+    logger_ring[logger_head & LOGGER_RING_MASK].addr = addr;
+    logger_head++;
+}
+
+void logger_flush(void) {
+    struct logger_record *record;
+    uint8_t lines = 0;
+
+    while (logger_tail != logger_head) {
+        record = &logger_ring[logger_tail & LOGGER_RING_MASK];
+        if (lines < LOGGER_LINES_PER_FLUSH) {
+            printf("[INFO] decode_and_exec: Unrecognised instruction '%04x' at %03x\n",
+                record->instruction, record->addr);
+            lines++;
+        } else {
+            logger_suppressed++;
+        }
+        logger_tail++;
+    }
+    if (logger_suppressed) {
+        printf("[INFO] decode_and_exec: %u more unrecognised instructions suppressed\n",
+            logger_suppressed);
+        logger_suppressed = 0;
+    }
+}
+
+void logger_summary(void) {
+    uint32_t total = 0;
+
+    for (uint32_t i = 0; i < NUM_OPCODES; i++) {
+        total += logger_counts[i];
+    }
+    if (!total) {
+        return;
+    }
+    printf("[INFO] Unrecognised instructions executed: %u\n", total);
+    for (uint32_t i = 0; i < NUM_OPCODES; i++) {
+        if (logger_counts[i]) {
+            printf("  %04x: %u (first at %03x)\n", i, logger_counts[i], logger_first_addr[i]);
+        }
+    }
+}
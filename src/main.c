@@ -7,115 +7,89 @@
 
 #include "chip8.h"
 #include "peripheral.h"
+#include "rewind.h"
+#include "logger.h"
+#include "profile.h"
+#include "trace.h"
+#include "callprof.h"
+#include "sampler.h"
+#include "coverage.h"
+#include "debugger.h"
+#include "audio.h"
 
 #define MIN_ARGC 2
-#define MAX_ARGC 4
-#define USAGE "rom_path [1..256] (draw scale) [single|double] (buffering)"
+#define MAX_ARGC 10
+#define USAGE "rom_path [1..256] (draw scale) [-single|-double|-phosphor] (buffering) [-trace] (execution trace) [-callprof] (call stack profile) [-sample] (pc sampling profile) [-coverage] (coverage report) [-debug] (debugger) [-audiosync] (pace by the audio clock)"
 
 #define CPU_HZ_DELAY 1.0 / 700
 #define DISPLAY_HZ_DELAY 1.0 / 60
 
 #define DEFAULT_RENDER_SCALE 8
-#define DEFAULT_USE_DOUBLE_BUFFER 1
-
-#ifdef DEBUG
-unsigned int steps_can_run = 0;
-
-void debug_print_keys(void) {
-    printf("Debug mode keys:\n");
-    printf("s         - step 1 instruction\n");
-    printf("s [n]     - step n (decimal) instructions\n");
-    printf("i         - print chip8 state\n");
-    printf("m [a]     - print memory at address a (hex)\n");
-    printf("m [a] [l] - print memory at address a (hex), length l (hex)\n");
-    printf("n         - print next opcode/instruction\n");
-    printf("h         - print this list again\n");
-    printf("q         - quit\n");
+#define DEFAULT_VIDEO_MODE VIDEO_DOUBLE_BUFFER
+
+#define REWIND_KEY 0x24
+
+uint8_t use_callprof = 0;
+uint8_t use_sampler = 0;
+uint8_t use_coverage = 0;
+
+// Write out everything recorded during the session and close SDL.
+void emulator_close(void) {
+    logger_flush();
+    logger_summary();
+    PROFILE_REPORT();
+    trace_close();
+    if (use_callprof) {
+        callprof_write(CALLPROF_FILE_NAME);
+    }
+    if (use_sampler) {
+        sampler_report();
+    }
+    if (use_coverage) {
+        coverage_write(COVERAGE_FILE_NAME);
+    }
+    chip8_flush_rpl_flags();
+    sdl_close();
 }
-#endif  // DEBUG
-
-void debug(void) {
-#ifdef DEBUG
-    char buffer[64];
-    short mem_addr;
-    short mem_len;
-
-    if (steps_can_run > 0) {
-        steps_can_run--;
-    } else {
-        // while (!steps_can_run) {
-        for (;;) {
-            printf("> ");
-            if (!fgets(buffer, 64, stdin) || !strnlen(buffer, 64)) {
-                continue;
-            }
-            if (buffer[0] == 's') {
-                if (sscanf(buffer, "%*s %u", &steps_can_run) == -1) {
-                    steps_can_run = 1;
-                }
-                if (steps_can_run == 1) {
-                    printf("Running 1 step\n");
-                } else {
-                    printf("Running %u steps\n", steps_can_run);
-                }
-                steps_can_run--;
-                break;
-            }
-            else if (buffer[0] == 'i') {
-                chip8_print_state();
-            }
-            else if (buffer[0] == 'm') {
-                mem_len = 1;
-                if (sscanf(buffer, "%*s %hx %hx", &mem_addr, &mem_len) != -1) {
-                    chip8_print_memory(mem_addr, mem_len);
-                }
-            }
-            else if (buffer[0] == 'n') {
-                printf("Next ");
-                chip8_print_next_op();
-            }
-            else if (buffer[0] == 'h') {
-                debug_print_keys();
-            }
-            else if (buffer[0] == 'q') {
-                sdl_close();
-                exit(0);
-            } else {
-                printf("Invalid command.\n");
-            }
 
-            usleep(8);
-        }
+// Current time in seconds, from the wall clock or paced by the audio device
+double emulator_time(uint8_t use_audio_sync) {
+    struct timeval time;
+    double time_sec;
 
-    }
-    printf("Running ");
-    chip8_print_next_op();
-#endif  // DEBUG
+    gettimeofday(&time, NULL);
+    time_sec = time.tv_sec + (time.tv_usec / 1000000.0);
+    return use_audio_sync ? audio_pace(time_sec) : time_sec;
 }
 
 void handle_state_controls(uint8_t last_input) {
-    if (0x01 & last_input) {
+    // Exact codes, as F10 (0x23) shares bits with F5 (0x21) and F9 (0x22)
+    if (last_input == 0x21) {
         chip8_write_state();
     }
-    else if (0x02 & last_input) {
+    else if (last_input == 0x22) {
         chip8_load_state();
+        debugger_reset_history();
+        sdl_draw_invalidate();
     }
-    else if (0x03 & last_input) {
+    else if (last_input == 0x23) {
         chip8_display_updated = 1;
+        sdl_draw_invalidate();
     }
 }
 
 int main(int argc, char *argv[]) {
-    struct timeval time;
     double time_sec;
-#ifndef DEBUG
     double next_cycle;
     double next_display;
-#endif  // n DEBUG
     uint8_t input;
     uint8_t last_input = 0;
+    uint8_t last_sound_off = 1;
     uint8_t render_scale = DEFAULT_RENDER_SCALE;
-    uint8_t use_double_buffering = DEFAULT_USE_DOUBLE_BUFFER;
+    uint8_t video_mode = DEFAULT_VIDEO_MODE;
+    uint8_t use_trace = 0;
+    uint8_t use_debugger = 0;
+    uint8_t use_audio_sync = 0;
     
     // Args check and parse
     if (argc < MIN_ARGC || argc > MAX_ARGC) {
@@ -125,13 +99,41 @@ int main(int argc, char *argv[]) {
     }
     for (int i = 2; i < argc; i++) {
         int failure = 1;
-        if (argv[i][0] == '-') {  // buffering
+        if (argv[i][0] == '-') {  // options
             if (strncmp(argv[i], "-single", 9) == 0) {
-                use_double_buffering = 0;
+                video_mode = VIDEO_SINGLE_BUFFER;
                 failure = 0;
             }
             else if (strncmp(argv[i], "-double", 9) == 0) {
-                use_double_buffering = 1;
+                video_mode = VIDEO_DOUBLE_BUFFER;
+                failure = 0;
+            }
+            else if (strncmp(argv[i], "-phosphor", 9) == 0) {
+                video_mode = VIDEO_PHOSPHOR;
+                failure = 0;
+            }
+            else if (strncmp(argv[i], "-trace", 9) == 0) {
+                use_trace = 1;
+                failure = 0;
+            }
+            else if (strncmp(argv[i], "-callprof", 9) == 0) {
+                use_callprof = 1;
+                failure = 0;
+            }
+            else if (strncmp(argv[i], "-sample", 9) == 0) {
+                use_sampler = 1;
+                failure = 0;
+            }
+            else if (strncmp(argv[i], "-coverage", 9) == 0) {
+                use_coverage = 1;
+                failure = 0;
+            }
+            else if (strncmp(argv[i], "-debug", 9) == 0) {
+                use_debugger = 1;
+                failure = 0;
+            }
+            else if (strncmp(argv[i], "-audiosync", 11) == 0) {
+                use_audio_sync = 1;
                 failure = 0;
             }
         } else {  // render scale
@@ -145,64 +147,105 @@ int main(int argc, char *argv[]) {
     }
 
     // Initialisation
-    if (sdl_init(render_scale, use_double_buffering) != 0) {
+    if (use_sampler) {
+        sampler_init();  // before SDL and trace threads are created
+    }
+    audio_clocked = use_audio_sync;  // before the audio device starts
+    if (sdl_init(render_scale, video_mode) != 0) {
         return -1;
     }
 
     chip8_init();
     chip8_load_rom(argv[1]);
+    rewind_init();
+    PROFILE_INIT();
+    if (use_trace && trace_open(TRACE_FILE_NAME) == 0) {
+        chip8_trace_hook = &trace_record;
+    }
+    if (use_callprof) {
+        callprof_init();
+    }
+    if (use_sampler && sampler_start() != 0) {
+        use_sampler = 0;
+    }
 
-    gettimeofday(&time, NULL);
-    time_sec = time.tv_sec + (time.tv_usec / 1000000.0);
-#ifndef DEBUG
+    time_sec = emulator_time(use_audio_sync);
     next_cycle = time_sec;
     next_display = time_sec;
-#endif  // n DEBUG
     chip8_next_timer_update = time_sec;  // manually set next timer update time
     chip8_sound_off = 1;
     
-#ifdef DEBUG
-    debug_print_keys();
-#endif  // DEBUG
+    if (use_debugger) {
+        debugger_init();
+    }
 
     // Emulation loop
     while (!peripheral_quit_flag && !chip8_exit_flag) {
-        debug();
-        gettimeofday(&time, NULL);
-        time_sec = time.tv_sec + (time.tv_usec / 1000000.0);
+        time_sec = emulator_time(use_audio_sync);
         
-#ifndef DEBUG
         if (time_sec > next_cycle) {
-#endif  // n DEBUG
             input = sdl_input_step();
-            chip8_step(input, time_sec);
+            if (input != REWIND_KEY) {
+                if (!use_debugger) {
+                    chip8_step(input, time_sec);
+                } else if (debugger_step(input, time_sec)) {
+                    // Restart pacing after waiting at the debugger prompt
+                    time_sec = emulator_time(use_audio_sync);
+                    next_cycle = time_sec;
+                    next_display = time_sec;
+                    chip8_next_timer_update = time_sec;
+                }
+                if (use_callprof) {
+                    callprof_step();
+                }
+            } else {
+                // Hold timers while rewinding rather than catching up afterwards
+                chip8_next_timer_update = time_sec;
+            }
             if ((last_input & 0x20) && !(input & 0x20)) {
                 // on release of state control key
                 handle_state_controls(last_input);
             }
             last_input = input;
-#ifndef DEBUG
             next_cycle += CPU_HZ_DELAY;
         }
 
         if (time_sec > next_display) {
-#endif  // n DEBUG
-            if (chip8_display_updated) {
+            // Record one rewind frame per displayed frame, or step back one while rewinding
+            if (last_input == REWIND_KEY) {
+                rewind_step();
+                debugger_reset_history();
+            } else {
+                rewind_push();
+            }
+
+            logger_flush();
+            PROFILE_POLL();
+            if (use_sampler) {
+                sampler_poll();
+            }
+
+            if (chip8_display_updated || peripheral_fading) {
                 sdl_draw_step(chip8_display);
                 chip8_display_updated = 0;
             }
-#ifndef DEBUG
             next_display += DISPLAY_HZ_DELAY;
         }
-#endif  // n DEBUG
 
-        // Pause/unpause audio based on sound timer
-        SDL_PauseAudio(chip8_sound_off);
+        // Gate the beep on sound timer changes, stamped so the audio callback
+        // places each edge at the matching sample
+        if (chip8_sound_off != last_sound_off) {
+            audio_push(!chip8_sound_off, time_sec);
+            last_sound_off = chip8_sound_off;
+        }
 
         // Very brief sleep to reduce CPU load of this busy loop
         usleep(8);
     }
 
-    sdl_close();
+    emulator_close();
+    if (use_audio_sync) {
+        audio_pace_report();  // after the audio device is closed
+    }
     return 0;
 }
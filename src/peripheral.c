@@ -1,5 +1,9 @@
+#include <sys/time.h>
+
 #include "peripheral.h"
 #include "chip8.h"
+#include "pixel.h"
+#include "audio.h"
 
 #define FAILURE -1
 #define SUCCESS 0
@@ -7,54 +11,26 @@
 #define AUDIO_N_CHANNELS 1
 #define AUDIO_SAMPLE_RATE 44100
 #define AUDIO_BUFFER_SIZE 512
-#define AUDIO_OSCILLATION_RATE 440.0f
 
 void sdl_audio_callback(void *, Uint8 *, int);
 
-struct {
-    float current_step;
-    float step_size;
-} oscillator;
-
 SDL_Window *window;
 SDL_Renderer *renderer;
+SDL_Texture *texture;  // DISPLAY_RES_X * DISPLAY_RES_Y, scaled up by the renderer
 uint8_t draw_scale;
 
-// Video single/double buffering
-uint8_t (*buffer_draw_colour_cmp_fn)(uint8_t *, uint16_t);
-void (*buffer_fn)(uint8_t *);
-uint8_t video_last_frame[DISPLAY_RES_X * DISPLAY_RES_Y];
-
-// Check only the current display buffer to determine if a pixel should be on.
-uint8_t single_buffer_colour(uint8_t *display, uint16_t i) {
-    return display[i];
-}
+// Video single/double buffering or phosphor, see VIDEO_*
+uint8_t video_mode;
+uint8_t video_last_frame[DISPLAY_RES_X * DISPLAY_RES_Y];  // rewritten by each draw
+uint8_t video_intensity[DISPLAY_RES_X * DISPLAY_RES_Y];   // phosphor
 
-// Check both the current and last display buffer to determine if a pixel should be on.
-uint8_t double_buffer_colour(uint8_t *display, uint16_t i) {
-    return display[i] | video_last_frame[i];
-}
-
-// Do nothing with the current buffer.
-void single_buffer_post_draw(uint8_t *display) {  // do nothing
-    (void) display;
-}
+// Hashes of the last two frames drawn, newest first, to skip unchanged frames
+uint64_t video_drawn_hash[2];
+uint8_t video_force_draw;
 
-// Copy the current buffer into the last frame buffer for next draw double buffering.
-void double_buffer_post_draw(uint8_t *display) {
-    memcpy(video_last_frame, display, DISPLAY_RES_X * DISPLAY_RES_Y);
-}
-
-uint8_t sdl_init(uint8_t scale, uint8_t double_buffer) {
+uint8_t sdl_init(uint8_t scale, uint8_t mode) {
     draw_scale = scale;
-
-    if (double_buffer) {
-        buffer_draw_colour_cmp_fn = &double_buffer_colour;
-        buffer_fn = &double_buffer_post_draw;
-    } else {
-        buffer_draw_colour_cmp_fn = &single_buffer_colour;
-        buffer_fn = &single_buffer_post_draw;  // do nothing
-    }
+    video_mode = mode;
 
     if (SDL_Init(SDL_INIT_AUDIO | SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
         fprintf(stderr, "SDL_Init Error: %s\n", SDL_GetError());
@@ -62,6 +38,8 @@ uint8_t sdl_init(uint8_t scale, uint8_t double_buffer) {
     }
 
     // Init audio
+    audio_init(AUDIO_SAMPLE_RATE);  // SDL converts if the device rate differs
+    audio_pace_init(AUDIO_BUFFER_SIZE);
     SDL_AudioSpec audio_spec = {
         .format = AUDIO_F32,
         .channels = AUDIO_N_CHANNELS,
@@ -74,8 +52,7 @@ uint8_t sdl_init(uint8_t scale, uint8_t double_buffer) {
         fprintf(stderr, "SDL_OpenAudio Error: %s\n", SDL_GetError());
         return FAILURE;
     }
-    oscillator.current_step = 0;
-    oscillator.step_size = (2 * M_PI) / AUDIO_OSCILLATION_RATE;
+    SDL_PauseAudio(0);  // always running, silent until `audio_push` turns the beep on
 
     // Init window/video
     window = SDL_CreateWindow("CHIP-8 Emulator", SDL_WINDOWPOS_CENTERED,
@@ -88,15 +65,30 @@ uint8_t sdl_init(uint8_t scale, uint8_t double_buffer) {
     }
     renderer = SDL_CreateRenderer(window, -1,
         SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    if (!renderer) {
+        // e.g. no GPU/headless (dummy video driver)
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+    }
     if (!renderer) {
         fprintf(stderr, "SDL_CreateRenderer Error: %s\n", SDL_GetError());
         sdl_close();
         return FAILURE;
     }
+    texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING, DISPLAY_RES_X, DISPLAY_RES_Y);
+    if (!texture) {
+        fprintf(stderr, "SDL_CreateTexture Error: %s\n", SDL_GetError());
+        sdl_close();
+        return FAILURE;
+    }
     // Start with a clear screen
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
     memset(video_last_frame, 0, DISPLAY_RES_X * DISPLAY_RES_Y);
+    memset(video_intensity, 0, DISPLAY_RES_X * DISPLAY_RES_Y);
+    peripheral_fading = 0;
+    video_drawn_hash[0] = chip8_display_hash(video_last_frame);
+    video_drawn_hash[1] = video_drawn_hash[0];
 
     peripheral_quit_flag = 0;
     return SUCCESS;
@@ -104,6 +96,9 @@ uint8_t sdl_init(uint8_t scale, uint8_t double_buffer) {
 
 void sdl_close(void) {
     SDL_CloseAudio();
+    if (texture) {
+        SDL_DestroyTexture(texture);
+    }
     if (renderer) {
         SDL_DestroyRenderer(renderer);
     }
@@ -194,50 +189,62 @@ uint8_t sdl_input_step(void) {
     else if (keyboard[SDL_SCANCODE_F10]) {
         input = 0x23;
     }
+    // Rewind (while held)
+    else if (keyboard[SDL_SCANCODE_F7]) {
+        input = 0x24;
+    }
 
     return input;
 }
 
 void sdl_draw_step(uint8_t *display) {
-    SDL_Rect rect;
-    uint8_t  x;
-    uint8_t  y;
-    uint16_t i;
-    
-    // Draw rectangles for each pixel
-    for (x = 0; x < DISPLAY_RES_X; x++) {
-        for (y = 0; y < DISPLAY_RES_Y; y++) {
-            i = (y * DISPLAY_RES_X) + x;
-            rect.x = x * draw_scale;
-            rect.y = y * draw_scale;
-            rect.w = draw_scale;
-            rect.h = draw_scale;
-
-            // Call single or double buffer cmp based on how sdl_init was called
-            if ((*buffer_draw_colour_cmp_fn)(display, i)) {
-                SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
-            } else {
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            }
-            SDL_RenderFillRect(renderer, &rect);
-        }
+    void *texels;
+    int pitch;
+    uint64_t hash = chip8_display_hash(display);
+
+    // Skip frames identical to what is on screen, e.g. a sprite drawn and erased
+    // within a frame. Double buffering shows this and the last frame combined,
+    // so the frame before must match as well, and phosphor must not be fading.
+    if (!video_force_draw && !peripheral_fading && hash == video_drawn_hash[0]
+        && (video_mode != VIDEO_DOUBLE_BUFFER || hash == video_drawn_hash[1])) {
+        peripheral_frames_skipped++;
+        return;
+    }
+    video_drawn_hash[1] = video_drawn_hash[0];
+    video_drawn_hash[0] = hash;
+    video_force_draw = 0;
+
+    // Expand the display (combined with the last frame if double buffering)
+    // straight into the texture. The last frame is replaced in the same pass.
+    if (SDL_LockTexture(texture, NULL, &texels, &pitch) != 0) {
+        fprintf(stderr, "SDL_LockTexture Error: %s\n", SDL_GetError());
+        return;
+    }
+    if (video_mode == VIDEO_PHOSPHOR) {
+        peripheral_fading = pixel_expand_phosphor(texels, pitch, display, video_intensity, PIXEL_PHOSPHOR_DECAY);
+    } else {
+        pixel_expand(texels, pitch, display, video_mode == VIDEO_DOUBLE_BUFFER ? video_last_frame : NULL);
     }
-
-    // Call buffering function for single (do nothing) or double buffering.
-    (*buffer_fn)(display);
+    SDL_UnlockTexture(texture);
 
     // Render all drawings
+    SDL_RenderCopy(renderer, texture, NULL, NULL);
     SDL_RenderPresent(renderer);
 }
 
-// Fill audio buffer with a constant frequency set by `oscillator`.
+void sdl_draw_invalidate(void) {
+    video_force_draw = 1;
+}
+
+// Fill audio buffer with the beep, gated by the sound events sent by `audio_push`.
 void sdl_audio_callback(void *user_data, uint8_t *stream, int len) {
+    struct timeval time;
+
     (void) user_data;   // unused
-    (void) len;         // unused
-    float *fstream = (float *) stream;
-    
-    for (int i = 0; i < AUDIO_BUFFER_SIZE; i++) {
-        oscillator.current_step += oscillator.step_size;
-        fstream[i] = sinf(oscillator.current_step);
+    if (audio_clocked) {
+        audio_fill_clocked(stream, len);
+        return;
     }
+    gettimeofday(&time, NULL);  // the clock the main loop stamps events with
+    audio_fill(stream, len, time.tv_sec + (time.tv_usec / 1000000.0));
 }
\ No newline at end of file
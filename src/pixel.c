@@ -0,0 +1,165 @@
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "chip8.h"
+#include "pixel.h"
+
+// One row at a time, so texture rows may be padded (pitch). When `store` is
+// set, the display row is also copied there (the next frame's last frame),
+// which may be `last_frame` itself as each pixel is read before it is stored.
+void pixel_expand_row_scalar(uint32_t *texels, const uint8_t *display, const uint8_t *last_frame, uint8_t *store) {
+    uint8_t pixel;
+
+    for (uint16_t x = 0; x < DISPLAY_RES_X; x++) {
+        pixel = display[x];
+        texels[x] = (pixel | last_frame[x]) ? PIXEL_ON : PIXEL_OFF;
+        if (store) {
+            store[x] = pixel;
+        }
+    }
+}
+
+#if defined(__SSE2__)
+// 16 pixels at a time: the ORed pixels become 0x00/0xFF bytes, which are
+// widened to 32 bits by unpacking with themselves, then given an alpha.
+void pixel_expand_row_sse2(uint32_t *texels, const uint8_t *display, const uint8_t *last_frame, uint8_t *store) {
+    const __m128i alpha = _mm_set1_epi32((int) PIXEL_OFF);
+    const __m128i zero = _mm_setzero_si128();
+    __m128i pixels;
+    __m128i on;
+    __m128i half;
+
+    for (uint16_t x = 0; x < DISPLAY_RES_X; x += 16) {
+        pixels = _mm_loadu_si128((const __m128i *) &display[x]);
+        on = _mm_or_si128(pixels, _mm_loadu_si128((const __m128i *) &last_frame[x]));
+        on = _mm_cmpgt_epi8(on, zero);
+        if (store) {
+            _mm_storeu_si128((__m128i *) &store[x], pixels);
+        }
+
+        half = _mm_unpacklo_epi8(on, on);
+        _mm_storeu_si128((__m128i *) &texels[x],      _mm_or_si128(_mm_unpacklo_epi16(half, half), alpha));
+        _mm_storeu_si128((__m128i *) &texels[x + 4],  _mm_or_si128(_mm_unpackhi_epi16(half, half), alpha));
+        half = _mm_unpackhi_epi8(on, on);
+        _mm_storeu_si128((__m128i *) &texels[x + 8],  _mm_or_si128(_mm_unpacklo_epi16(half, half), alpha));
+        _mm_storeu_si128((__m128i *) &texels[x + 12], _mm_or_si128(_mm_unpackhi_epi16(half, half), alpha));
+    }
+}
+#endif
+
+#if defined(__AVX2__)
+// 32 pixels at a time: the ORed pixels become 0x00/0xFF bytes, which are
+// sign extended to 0x00000000/0xFFFFFFFF, 8 at a time, then given an alpha.
+void pixel_expand_row_avx2(uint32_t *texels, const uint8_t *display, const uint8_t *last_frame, uint8_t *store) {
+    const __m256i alpha = _mm256_set1_epi32((int) PIXEL_OFF);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i pixels;
+    __m256i on;
+    __m128i low;
+    __m128i high;
+
+    for (uint16_t x = 0; x < DISPLAY_RES_X; x += 32) {
+        pixels = _mm256_loadu_si256((const __m256i *) &display[x]);
+        on = _mm256_or_si256(pixels, _mm256_loadu_si256((const __m256i *) &last_frame[x]));
+        on = _mm256_cmpgt_epi8(on, zero);
+        if (store) {
+            _mm256_storeu_si256((__m256i *) &store[x], pixels);
+        }
+        low = _mm256_castsi256_si128(on);
+        high = _mm256_extracti128_si256(on, 1);
+
+        _mm256_storeu_si256((__m256i *) &texels[x],      _mm256_or_si256(_mm256_cvtepi8_epi32(low), alpha));
+        _mm256_storeu_si256((__m256i *) &texels[x + 8],  _mm256_or_si256(_mm256_cvtepi8_epi32(_mm_srli_si128(low, 8)), alpha));
+        _mm256_storeu_si256((__m256i *) &texels[x + 16], _mm256_or_si256(_mm256_cvtepi8_epi32(high), alpha));
+        _mm256_storeu_si256((__m256i *) &texels[x + 24], _mm256_or_si256(_mm256_cvtepi8_epi32(_mm_srli_si128(high, 8)), alpha));
+    }
+}
+#endif
+
+// Phosphor: intensity falls by `decay` per frame, and is restored to full by
+// the pixel being on. Returns non-zero if any pixel in the row is still fading.
+uint8_t pixel_phosphor_row_scalar(uint32_t *texels, const uint8_t *display, uint8_t *intensity, uint8_t decay) {
+    uint8_t fading = 0;
+    uint8_t level;
+
+    for (uint16_t x = 0; x < DISPLAY_RES_X; x++) {
+        level = display[x] ? 0xFF : (intensity[x] > decay ? intensity[x] - decay : 0);
+        intensity[x] = level;
+        fading |= display[x] ? 0 : level;
+        texels[x] = PIXEL_OFF | level * 0x010101;
+    }
+    return fading;
+}
+
+#if defined(__SSE2__)
+// 16 pixels at a time with saturating byte arithmetic: max(on, intensity - decay).
+// Grey levels are widened to 32 bits (0x00LLLLLL) by unpacking with themselves.
+uint8_t pixel_phosphor_row_sse2(uint32_t *texels, const uint8_t *display, uint8_t *intensity, uint8_t decay) {
+    const __m128i alpha = _mm_set1_epi32((int) PIXEL_OFF);
+    const __m128i colour = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i step = _mm_set1_epi8((char) decay);
+    __m128i fading = zero;
+    __m128i on;
+    __m128i level;
+    __m128i half;
+
+    for (uint16_t x = 0; x < DISPLAY_RES_X; x += 16) {
+        on = _mm_cmpgt_epi8(_mm_loadu_si128((const __m128i *) &display[x]), zero);
+        level = _mm_subs_epu8(_mm_loadu_si128((const __m128i *) &intensity[x]), step);
+        level = _mm_max_epu8(level, on);
+        _mm_storeu_si128((__m128i *) &intensity[x], level);
+        fading = _mm_or_si128(fading, _mm_andnot_si128(on, level));
+
+        half = _mm_unpacklo_epi8(level, level);
+        _mm_storeu_si128((__m128i *) &texels[x],      _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi16(half, half), colour), alpha));
+        _mm_storeu_si128((__m128i *) &texels[x + 4],  _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi16(half, half), colour), alpha));
+        half = _mm_unpackhi_epi8(level, level);
+        _mm_storeu_si128((__m128i *) &texels[x + 8],  _mm_or_si128(_mm_and_si128(_mm_unpacklo_epi16(half, half), colour), alpha));
+        _mm_storeu_si128((__m128i *) &texels[x + 12], _mm_or_si128(_mm_and_si128(_mm_unpackhi_epi16(half, half), colour), alpha));
+    }
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(fading, zero)) != 0xFFFF;
+}
+#endif
+
+void pixel_expand(uint32_t *texels, int pitch, const uint8_t *display, uint8_t *last_frame) {
+    const uint8_t *last = last_frame ? last_frame : display;  // display | display = display
+
+    for (uint16_t y = 0; y < DISPLAY_RES_Y; y++) {
+#if defined(__AVX2__)
+        pixel_expand_row_avx2(texels, display, last, last_frame);
+#elif defined(__SSE2__)
+        pixel_expand_row_sse2(texels, display, last, last_frame);
+#else
+        pixel_expand_row_scalar(texels, display, last, last_frame);
+#endif
+        texels = (uint32_t *) ((uint8_t *) texels + pitch);
+        display += DISPLAY_RES_X;
+        last += DISPLAY_RES_X;
+        if (last_frame) {
+            last_frame += DISPLAY_RES_X;
+        }
+    }
+}
+
+uint8_t pixel_expand_phosphor(uint32_t *texels, int pitch, const uint8_t *display, uint8_t *intensity, uint8_t decay) {
+    uint8_t fading = 0;
+
+    for (uint16_t y = 0; y < DISPLAY_RES_Y; y++) {
+#if defined(__SSE2__)
+        fading |= pixel_phosphor_row_sse2(texels, display, intensity, decay);
+#else
+        fading |= pixel_phosphor_row_scalar(texels, display, intensity, decay);
+#endif
+        texels = (uint32_t *) ((uint8_t *) texels + pitch);
+        display += DISPLAY_RES_X;
+        intensity += DISPLAY_RES_X;
+    }
+    return fading;
+}
@@ -0,0 +1,131 @@
+#ifdef PROFILE
+
+#include <stdio.h>
+#include <signal.h>
+
+#include "profile.h"
+#include "chip8.h"
+
+#define PROFILE_ADDR_SPACE 0x1000
+#define PROFILE_TOP_ADDRS 16
+
+uint64_t profile_class_counts[NUM_OP_CLASSES];
+uint64_t profile_class_ticks[NUM_OP_CLASSES];
+uint64_t profile_addr_counts[PROFILE_ADDR_SPACE];
+
+volatile sig_atomic_t profile_report_requested;
+
+void profile_signal_handler(int signal) {
+    (void) signal;
+    profile_report_requested = 1;
+}
+
+void profile_record(uint16_t instruction, uint16_t addr, uint64_t ticks) {
+    uint8_t op_class = chip8_op_class(instruction);
+
+    profile_class_counts[op_class]++;
+    profile_class_ticks[op_class] += ticks;
+    profile_addr_counts[addr & (PROFILE_ADDR_SPACE - 1)]++;
+}
+
+void profile_init(void) {
+    signal(SIGUSR1, profile_signal_handler);
+}
+
+void profile_poll(void) {
+    if (profile_report_requested) {
+        profile_report_requested = 0;
+        profile_report();
+    }
+}
+
+void profile_write_json(void) {
+    FILE *f;
+    const char *separator = "";
+
+    f = fopen(PROFILE_REPORT_FILE_NAME, "w");
+    if (!f) {
+        fprintf(stderr, "profile_report: Failed to open '%s'\n", PROFILE_REPORT_FILE_NAME);
+        return;
+    }
+
+    fprintf(f, "{\n  \"classes\": [");
+    for (int i = 0; i < NUM_OP_CLASSES; i++) {
+        if (!profile_class_counts[i]) {
+            continue;
+        }
+        fprintf(f, "%s\n    {\"class\": \"%s\", \"count\": %llu, \"ticks\": %llu}", separator,
+            chip8_op_class_name(i), (unsigned long long) profile_class_counts[i],
+            (unsigned long long) profile_class_ticks[i]);
+        separator = ",";
+    }
+    fprintf(f, "\n  ],\n  \"addresses\": [");
+    separator = "";
+    for (int i = 0; i < PROFILE_ADDR_SPACE; i++) {
+        if (!profile_addr_counts[i]) {
+            continue;
+        }
+        fprintf(f, "%s\n    {\"addr\": %d, \"count\": %llu}", separator, i,
+            (unsigned long long) profile_addr_counts[i]);
+        separator = ",";
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}
+
+void profile_report(void) {
+    uint64_t total_count = 0;
+    uint64_t total_ticks = 0;
+    uint16_t top[PROFILE_TOP_ADDRS];
+    int n_top = 0;
+    int j;
+
+    for (int i = 0; i < NUM_OP_CLASSES; i++) {
+        total_count += profile_class_counts[i];
+        total_ticks += profile_class_ticks[i];
+    }
+    if (!total_count) {
+        return;
+    }
+
+    printf("* Profile: %llu instructions, %llu ticks\n",
+        (unsigned long long) total_count, (unsigned long long) total_ticks);
+    printf("class     count   %%count      ticks/op\n");
+    for (int i = 0; i < NUM_OP_CLASSES; i++) {
+        if (!profile_class_counts[i]) {
+            continue;
+        }
+        printf("%s %12llu %7.2f%% %12.1f\n", chip8_op_class_name(i),
+            (unsigned long long) profile_class_counts[i],
+            100.0 * profile_class_counts[i] / total_count,
+            (double) profile_class_ticks[i] / profile_class_counts[i]);
+    }
+
+    // Insertion sort of the hottest addresses
+    for (int i = 0; i < PROFILE_ADDR_SPACE; i++) {
+        if (!profile_addr_counts[i]) {
+            continue;
+        }
+        if (n_top < PROFILE_TOP_ADDRS) {
+            j = n_top++;
+        } else if (profile_addr_counts[i] > profile_addr_counts[top[PROFILE_TOP_ADDRS - 1]]) {
+            j = PROFILE_TOP_ADDRS - 1;
+        } else {
+            continue;
+        }
+        for (; j > 0 && profile_addr_counts[i] > profile_addr_counts[top[j - 1]]; j--) {
+            top[j] = top[j - 1];
+        }
+        top[j] = i;
+    }
+    printf("\naddr        count   %%count\n");
+    for (int i = 0; i < n_top; i++) {
+        printf("%03x  %12llu %7.2f%%\n", top[i], (unsigned long long) profile_addr_counts[top[i]],
+            100.0 * profile_addr_counts[top[i]] / total_count);
+    }
+
+    fflush(stdout);
+    profile_write_json();
+}
+
+#endif  // PROFILE
@@ -0,0 +1,181 @@
+#include <string.h>
+
+#include "rewind.h"
+#include "chip8.h"
+
+// Runs of unchanged bytes shorter than this are stored as literals, as a
+// new run header would take more space than the bytes themselves.
+#define RLE_MIN_ZERO_RUN 4
+#define RLE_HEADER_SIZE 4
+
+// Worst case size of an encoded delta: every byte a literal, plus headers.
+#define ENCODED_MAX_SIZE (CHIP8_SNAPSHOT_SIZE + (CHIP8_SNAPSHOT_SIZE / RLE_MIN_ZERO_RUN + 1) * RLE_HEADER_SIZE)
+
+struct rewind_entry {
+    uint32_t offset;  // start of encoded delta in `rewind_pool`
+    uint32_t length;  // length of encoded delta in bytes
+};
+
+uint8_t rewind_pool[REWIND_POOL_SIZE];
+uint32_t rewind_pool_head;  // next write offset into `rewind_pool`
+
+// Ring of encoded deltas, newest at `rewind_entry_head - 1`
+struct rewind_entry rewind_entries[REWIND_MAX_FRAMES];
+uint16_t rewind_entry_head;
+uint16_t rewind_entry_count;
+
+// State at the last `rewind_push`, i.e. what applying the newest delta goes back from
+uint8_t rewind_current_frame[CHIP8_SNAPSHOT_SIZE];
+uint8_t rewind_next_frame[CHIP8_SNAPSHOT_SIZE];
+uint8_t rewind_encoded[ENCODED_MAX_SIZE];
+uint8_t have_rewind_current_frame;
+
+/*
+ * Encode the XOR of `a` and `b` as a sequence of
+ *   [zero run length (16 bits)][literal length (16 bits)][literal bytes]
+ * Returns the encoded length.
+ */
+uint32_t encode_delta(const uint8_t *a, const uint8_t *b, uint8_t *out) {
+    uint32_t len = 0;
+    uint32_t i = 0;
+    uint32_t lit_start;
+    uint16_t zero_run;
+    uint16_t lit_len;
+    uint16_t run;
+
+    while (i < CHIP8_SNAPSHOT_SIZE) {
+        zero_run = 0;
+        while (i < CHIP8_SNAPSHOT_SIZE && a[i] == b[i]) {
+            zero_run++;
+            i++;
+        }
+        // Literal continues until a long enough run of unchanged bytes is found
+        lit_start = i;
+        while (i < CHIP8_SNAPSHOT_SIZE) {
+            for (run = 0; i + run < CHIP8_SNAPSHOT_SIZE && run < RLE_MIN_ZERO_RUN
+                    && a[i + run] == b[i + run]; run++);
+            if (run == RLE_MIN_ZERO_RUN || i + run == CHIP8_SNAPSHOT_SIZE) {
+                break;
+            }
+            i += run + 1;
+        }
+        lit_len = i - lit_start;
+        if (zero_run == 0 && lit_len == 0) {
+            break;
+        }
+
+        out[len++] = zero_run & 0xFF;
+        out[len++] = zero_run >> 8;
+        out[len++] = lit_len & 0xFF;
+        out[len++] = lit_len >> 8;
+        for (uint16_t j = 0; j < lit_len; j++) {
+            out[len++] = a[lit_start + j] ^ b[lit_start + j];
+        }
+    }
+    return len;
+}
+
+// XOR an encoded delta into `frame`. Returns non-zero if a run would go past
+// the end of the delta or the frame (a corrupt delta), leaving `frame` partly applied.
+uint8_t apply_delta(uint8_t *frame, const uint8_t *in, uint32_t in_len) {
+    uint32_t pos = 0;
+    uint32_t i = 0;
+    uint16_t lit_len;
+
+    while (i < in_len) {
+        if (i + RLE_HEADER_SIZE > in_len) {
+            return 1;
+        }
+        pos += in[i] | in[i + 1] << 8;
+        lit_len = in[i + 2] | in[i + 3] << 8;
+        i += RLE_HEADER_SIZE;
+        if (pos + lit_len > CHIP8_SNAPSHOT_SIZE || i + lit_len > in_len) {
+            return 1;
+        }
+        for (uint16_t j = 0; j < lit_len; j++) {
+            frame[pos++] ^= in[i++];
+        }
+    }
+    return 0;
+}
+
+void rewind_init(void) {
+    rewind_pool_head = 0;
+    rewind_entry_head = 0;
+    rewind_entry_count = 0;
+    have_rewind_current_frame = 0;
+}
+
+// The oldest frame in the history, if any
+struct rewind_entry *rewind_oldest(void) {
+    return &rewind_entries[(rewind_entry_head + REWIND_MAX_FRAMES - rewind_entry_count) % REWIND_MAX_FRAMES];
+}
+
+void rewind_push(void) {
+    struct rewind_entry *oldest;
+    uint32_t len;
+
+    chip8_snapshot(rewind_next_frame);
+    if (!have_rewind_current_frame) {
+        memcpy(rewind_current_frame, rewind_next_frame, CHIP8_SNAPSHOT_SIZE);
+        have_rewind_current_frame = 1;
+        return;
+    }
+
+    len = encode_delta(rewind_next_frame, rewind_current_frame, rewind_encoded);
+
+    // Make room by dropping the oldest frames
+    if (rewind_entry_count == REWIND_MAX_FRAMES) {
+        rewind_entry_count--;
+    }
+    // Wrap to the start of the pool if the delta does not fit contiguously.
+    // Live deltas are in pool order from the oldest, so those in the abandoned
+    // tail (at or after the head) are the oldest, and go with it.
+    if (rewind_pool_head + len > REWIND_POOL_SIZE) {
+        while (rewind_entry_count > 0 && rewind_oldest()->offset >= rewind_pool_head) {
+            rewind_entry_count--;
+        }
+        rewind_pool_head = 0;
+    }
+    // Then the oldest frames in the way, until one is past the new delta
+    while (rewind_entry_count > 0) {
+        oldest = rewind_oldest();
+        if (oldest->offset >= rewind_pool_head + len || oldest->offset + oldest->length <= rewind_pool_head) {
+            break;
+        }
+        rewind_entry_count--;
+    }
+
+    memcpy(&rewind_pool[rewind_pool_head], rewind_encoded, len);
+    rewind_entries[rewind_entry_head].offset = rewind_pool_head;
+    rewind_entries[rewind_entry_head].length = len;
+    rewind_entry_head = (rewind_entry_head + 1) % REWIND_MAX_FRAMES;
+    rewind_entry_count++;
+    rewind_pool_head += len;
+
+    memcpy(rewind_current_frame, rewind_next_frame, CHIP8_SNAPSHOT_SIZE);
+}
+
+uint8_t rewind_step(void) {
+    struct rewind_entry *newest;
+
+    if (rewind_entry_count == 0) {
+        return 1;
+    }
+    rewind_entry_head = (rewind_entry_head + REWIND_MAX_FRAMES - 1) % REWIND_MAX_FRAMES;
+    rewind_entry_count--;
+    newest = &rewind_entries[rewind_entry_head];
+
+    if (apply_delta(rewind_current_frame, &rewind_pool[newest->offset], newest->length)) {
+        rewind_init();  // the current frame is no longer known
+        return 1;
+    }
+    // Space used by the popped delta can be reused by the next push
+    rewind_pool_head = newest->offset;
+    chip8_restore(rewind_current_frame);
+    return 0;
+}
+
+uint16_t rewind_frames_available(void) {
+    return rewind_entry_count;
+}
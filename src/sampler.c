@@ -0,0 +1,130 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "chip8.h"
+#include "sampler.h"
+
+#define SAMPLER_ADDR_SPACE 0x1000
+
+// Written only by the signal handler (head) or the polling thread (tail).
+// Both run on the emulation thread, so no atomics are needed beyond volatile.
+volatile uint32_t sampler_buffer[SAMPLER_BUFFER_SIZE];
+volatile sig_atomic_t sampler_head;
+volatile sig_atomic_t sampler_tail;
+volatile sig_atomic_t sampler_dropped;
+
+uint64_t sampler_addr_counts[SAMPLER_ADDR_SPACE];
+uint64_t sampler_class_counts[NUM_OP_CLASSES];
+uint64_t sampler_total;
+
+void sampler_signal_handler(int signal) {
+    sig_atomic_t head = sampler_head;
+
+    (void) signal;
+    if (((head - sampler_tail) & (SAMPLER_BUFFER_SIZE * 2 - 1)) == SAMPLER_BUFFER_SIZE) {
+        sampler_dropped++;
+        return;
+    }
+    sampler_buffer[head & (SAMPLER_BUFFER_SIZE - 1)] = chip8_sample();
+    sampler_head = (head + 1) & (SAMPLER_BUFFER_SIZE * 2 - 1);
+}
+
+void sampler_init(void) {
+    sigset_t set;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+}
+
+uint8_t sampler_start(void) {
+    struct sigaction action;
+    struct itimerval timer;
+    sigset_t set;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = sampler_signal_handler;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, NULL) != 0) {
+        fprintf(stderr, "sampler_start: Failed to install SIGPROF handler\n");
+        return 1;
+    }
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGPROF);
+    pthread_sigmask(SIG_UNBLOCK, &set, NULL);
+
+    timer.it_interval.tv_sec = 0;
+    timer.it_interval.tv_usec = 1000000 / SAMPLER_HZ;
+    timer.it_value = timer.it_interval;
+    if (setitimer(ITIMER_PROF, &timer, NULL) != 0) {
+        fprintf(stderr, "sampler_start: Failed to start profiling timer\n");
+        return 1;
+    }
+    return 0;
+}
+
+void sampler_poll(void) {
+    uint32_t sample;
+
+    while (sampler_tail != sampler_head) {
+        sample = sampler_buffer[sampler_tail & (SAMPLER_BUFFER_SIZE - 1)];
+        sampler_addr_counts[(sample >> 16) & (SAMPLER_ADDR_SPACE - 1)]++;
+        sampler_class_counts[chip8_op_class(sample & 0xFFFF)]++;
+        sampler_total++;
+        sampler_tail = (sampler_tail + 1) & (SAMPLER_BUFFER_SIZE * 2 - 1);
+    }
+}
+
+void sampler_report(void) {
+    struct itimerval timer;
+    uint16_t top[SAMPLER_TOP_ADDRS];
+    int n_top = 0;
+    int j;
+
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+    sampler_poll();
+
+    printf("* PC samples: %llu, %d dropped\n", (unsigned long long) sampler_total, (int) sampler_dropped);
+    if (!sampler_total) {
+        return;
+    }
+    printf("class    samples  %%samples\n");
+    for (int i = 0; i < NUM_OP_CLASSES; i++) {
+        if (!sampler_class_counts[i]) {
+            continue;
+        }
+        printf("%s %12llu %7.2f%%\n", chip8_op_class_name(i),
+            (unsigned long long) sampler_class_counts[i], 100.0 * sampler_class_counts[i] / sampler_total);
+    }
+
+    // Insertion sort of the most sampled addresses
+    for (int i = 0; i < SAMPLER_ADDR_SPACE; i++) {
+        if (!sampler_addr_counts[i]) {
+            continue;
+        }
+        if (n_top < SAMPLER_TOP_ADDRS) {
+            j = n_top++;
+        } else if (sampler_addr_counts[i] > sampler_addr_counts[top[SAMPLER_TOP_ADDRS - 1]]) {
+            j = SAMPLER_TOP_ADDRS - 1;
+        } else {
+            continue;
+        }
+        for (; j > 0 && sampler_addr_counts[i] > sampler_addr_counts[top[j - 1]]; j--) {
+            top[j] = top[j - 1];
+        }
+        top[j] = i;
+    }
+    printf("\naddr      samples  %%samples\n");
+    for (int i = 0; i < n_top; i++) {
+        printf("%03x  %12llu %7.2f%%\n", top[i], (unsigned long long) sampler_addr_counts[top[i]],
+            100.0 * sampler_addr_counts[top[i]] / sampler_total);
+    }
+    fflush(stdout);
+}
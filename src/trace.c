@@ -0,0 +1,297 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "trace.h"
+
+#define TRACE_BUFFER_SIZE (1 << 16)
+#define TRACE_NUM_BUFFERS 4
+#define TRACE_MAX_RECORD_SIZE 18  // flags + 10 byte varint + pc + op + I + reg
+#define TRACE_OP_UNKNOWN 0xFFFFFFFF
+
+struct trace_buffer {
+    uint8_t data[TRACE_BUFFER_SIZE];
+    uint32_t len;
+};
+
+FILE *trace_file;
+pthread_t trace_thread;
+pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t trace_cond = PTHREAD_COND_INITIALIZER;
+uint8_t trace_closing;
+
+// Buffers [trace_written, trace_filled) (mod TRACE_NUM_BUFFERS) are waiting
+// for the writer thread, the one at `trace_filled` is being filled.
+struct trace_buffer trace_buffers[TRACE_NUM_BUFFERS];
+uint32_t trace_filled;
+uint32_t trace_written;
+struct trace_buffer *trace_current;
+
+// Encoder state, see trace.h for how fields are predicted
+uint64_t trace_last_cycle;
+uint16_t trace_last_pc;
+uint16_t trace_last_I;
+uint32_t trace_ops[TRACE_ADDR_SPACE];  // TRACE_OP_UNKNOWN until first seen
+
+void *trace_writer(void *unused) {
+    struct trace_buffer *buffer;
+
+    (void) unused;
+    pthread_mutex_lock(&trace_mutex);
+    for (;;) {
+        while (trace_written == trace_filled && !trace_closing) {
+            pthread_cond_wait(&trace_cond, &trace_mutex);
+        }
+        if (trace_written == trace_filled) {
+            break;  // closing and nothing left
+        }
+        buffer = &trace_buffers[trace_written % TRACE_NUM_BUFFERS];
+        pthread_mutex_unlock(&trace_mutex);
+
+        fwrite(buffer->data, 1, buffer->len, trace_file);
+
+        pthread_mutex_lock(&trace_mutex);
+        trace_written++;
+        pthread_cond_signal(&trace_cond);
+    }
+    pthread_mutex_unlock(&trace_mutex);
+    return NULL;
+}
+
+// Hand the current buffer to the writer thread, waiting if all buffers are in use.
+void trace_submit(void) {
+    pthread_mutex_lock(&trace_mutex);
+    trace_filled++;
+    pthread_cond_signal(&trace_cond);
+    while (trace_filled - trace_written == TRACE_NUM_BUFFERS) {
+        pthread_cond_wait(&trace_cond, &trace_mutex);
+    }
+    pthread_mutex_unlock(&trace_mutex);
+
+    trace_current = &trace_buffers[trace_filled % TRACE_NUM_BUFFERS];
+    trace_current->len = 0;
+}
+
+// Reset field prediction and start filling the first buffer
+void trace_encoder_init(void) {
+    trace_last_cycle = (uint64_t) -1;
+    trace_last_pc = TRACE_INITIAL_PC;
+    trace_last_I = 0;
+    memset(trace_ops, 0xFF, sizeof(trace_ops));
+    trace_current = &trace_buffers[0];
+    trace_current->len = 0;
+}
+
+uint8_t trace_open(const char *path) {
+    uint8_t header[TRACE_HEADER_SIZE] = {0};
+
+    trace_file = fopen(path, "wb");
+    if (!trace_file) {
+        fprintf(stderr, "trace_open: Failed to open '%s'\n", path);
+        return 1;
+    }
+    memcpy(header, TRACE_MAGIC, 4);
+    header[4] = TRACE_VERSION;
+    fwrite(header, 1, TRACE_HEADER_SIZE, trace_file);
+
+    trace_encoder_init();
+    trace_closing = 0;
+    trace_filled = 0;
+    trace_written = 0;
+    if (pthread_create(&trace_thread, NULL, trace_writer, NULL) != 0) {
+        fprintf(stderr, "trace_open: Failed to start writer thread\n");
+        fclose(trace_file);
+        trace_file = NULL;  // nothing for `trace_close` to join or close
+        return 1;
+    }
+    return 0;
+}
+
+// Append one record to the current buffer, which has room for it. Flags are
+// kept in a register and stored last, as stores through `out` may alias them.
+static inline void trace_encode(const struct chip8_trace_record *record) {
+    uint8_t *start = &trace_current->data[trace_current->len];
+    uint8_t *out = start + 1;
+    uint8_t flags = 0;
+    uint16_t addr = record->pc & (TRACE_ADDR_SPACE - 1);
+    uint64_t cycle_delta = record->cycle - trace_last_cycle - 1;
+
+    if (cycle_delta) {
+        flags |= TRACE_FLAG_CYCLE;
+        while (cycle_delta >= 0x80) {
+            *out++ = (cycle_delta & 0x7F) | 0x80;
+            cycle_delta >>= 7;
+        }
+        *out++ = cycle_delta;
+    }
+    if (record->pc != (uint16_t) (trace_last_pc + 2)) {
+        flags |= TRACE_FLAG_PC;
+        *out++ = record->pc & 0xFF;
+        *out++ = record->pc >> 8;
+    }
+    if (trace_ops[addr] != record->instruction) {
+        flags |= TRACE_FLAG_OP;
+        *out++ = record->instruction & 0xFF;
+        *out++ = record->instruction >> 8;
+        trace_ops[addr] = record->instruction;
+    }
+    if (record->I != trace_last_I) {
+        flags |= TRACE_FLAG_I;
+        *out++ = record->I & 0xFF;
+        *out++ = record->I >> 8;
+    }
+    if (record->reg != CHIP8_TRACE_NO_REG) {
+        flags |= TRACE_FLAG_REG;
+        *out++ = record->reg;
+        *out++ = record->value;
+    }
+    *start = flags;
+
+    trace_last_cycle = record->cycle;
+    trace_last_pc = record->pc;
+    trace_last_I = record->I;
+    trace_current->len += out - start;
+}
+
+void trace_record(const struct chip8_trace_record *record) {
+    trace_encode(record);
+    if (trace_current->len > TRACE_BUFFER_SIZE - TRACE_MAX_RECORD_SIZE) {
+        trace_submit();
+    }
+}
+
+void trace_close(void) {
+    if (!trace_file) {
+        return;
+    }
+    pthread_mutex_lock(&trace_mutex);
+    if (trace_current->len) {
+        trace_filled++;
+    }
+    trace_closing = 1;
+    pthread_cond_signal(&trace_cond);
+    pthread_mutex_unlock(&trace_mutex);
+
+    pthread_join(trace_thread, NULL);
+    fclose(trace_file);
+    trace_file = NULL;
+}
+
+// Keep at least a full record buffered, unless at the end of the file.
+void trace_reader_fill(struct trace_reader *reader) {
+    if (reader->len - reader->pos >= TRACE_MAX_RECORD_SIZE) {
+        return;
+    }
+    memmove(reader->buffer, &reader->buffer[reader->pos], reader->len - reader->pos);
+    reader->len -= reader->pos;
+    reader->pos = 0;
+    reader->len += fread(&reader->buffer[reader->len], 1, TRACE_READER_BUFFER_SIZE - reader->len, reader->f);
+}
+
+uint16_t trace_reader_u16(struct trace_reader *reader) {
+    uint16_t value = reader->buffer[reader->pos] | reader->buffer[reader->pos + 1] << 8;
+    reader->pos += 2;
+    return value;
+}
+
+uint8_t trace_reader_open(struct trace_reader *reader, const char *path) {
+    uint8_t header[TRACE_HEADER_SIZE];
+
+    reader->f = fopen(path, "rb");
+    if (!reader->f) {
+        fprintf(stderr, "trace_reader_open: Failed to open '%s'\n", path);
+        return 1;
+    }
+    if (fread(header, 1, TRACE_HEADER_SIZE, reader->f) != TRACE_HEADER_SIZE
+            || memcmp(header, TRACE_MAGIC, 4) != 0 || header[4] != TRACE_VERSION) {
+        fprintf(stderr, "trace_reader_open: '%s' is not a version %d trace\n", path, TRACE_VERSION);
+        fclose(reader->f);
+        return 1;
+    }
+
+    reader->pos = 0;
+    reader->len = 0;
+    reader->last.cycle = (uint64_t) -1;
+    reader->last.pc = TRACE_INITIAL_PC;
+    reader->last.instruction = 0;
+    reader->last.I = 0;
+    memset(reader->ops, 0, sizeof(reader->ops));
+    return 0;
+}
+
+void trace_reader_error(struct trace_reader *reader, const char *error) {
+    if (reader->last.cycle == (uint64_t) -1) {
+        fprintf(stderr, "trace_reader_next: %s in the first record\n", error);
+    } else {
+        fprintf(stderr, "trace_reader_next: %s after cycle %llu\n", error, (unsigned long long) reader->last.cycle);
+    }
+}
+
+// Whether `n` more bytes of the current record are buffered. A whole record is
+// buffered by `trace_reader_fill` if there is one, so fewer means the trace
+// was cut short.
+uint8_t trace_reader_has(struct trace_reader *reader, uint32_t n) {
+    if (reader->len - reader->pos >= n) {
+        return 1;
+    }
+    trace_reader_error(reader, "Trace truncated");
+    return 0;
+}
+
+uint8_t trace_reader_next(struct trace_reader *reader, struct chip8_trace_record *record) {
+    uint64_t cycle_delta = 0;
+    uint8_t field_bytes = 0;
+    uint8_t shift = 0;
+    uint8_t flags;
+    uint8_t byte;
+
+    trace_reader_fill(reader);
+    if (reader->pos == reader->len) {
+        return 0;
+    }
+    flags = reader->buffer[reader->pos++];
+
+    if (flags & TRACE_FLAG_CYCLE) {
+        do {
+            if (shift >= 64) {  // more than 10 bytes
+                trace_reader_error(reader, "Corrupt cycle");
+                return 0;
+            }
+            if (!trace_reader_has(reader, 1)) {
+                return 0;
+            }
+            byte = reader->buffer[reader->pos++];
+            cycle_delta |= (uint64_t) (byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+    }
+    // The remaining fields are 2 bytes each
+    for (uint8_t flag = TRACE_FLAG_PC; flag <= TRACE_FLAG_REG; flag <<= 1) {
+        field_bytes += flags & flag ? 2 : 0;
+    }
+    if (!trace_reader_has(reader, field_bytes)) {
+        return 0;
+    }
+    record->cycle = reader->last.cycle + 1 + cycle_delta;
+    record->pc = flags & TRACE_FLAG_PC ? trace_reader_u16(reader) : (uint16_t) (reader->last.pc + 2);
+    if (flags & TRACE_FLAG_OP) {
+        reader->ops[record->pc & (TRACE_ADDR_SPACE - 1)] = trace_reader_u16(reader);
+    }
+    record->instruction = reader->ops[record->pc & (TRACE_ADDR_SPACE - 1)];
+    record->I = flags & TRACE_FLAG_I ? trace_reader_u16(reader) : reader->last.I;
+    record->reg = CHIP8_TRACE_NO_REG;
+    record->value = 0;
+    if (flags & TRACE_FLAG_REG) {
+        record->reg = reader->buffer[reader->pos++];
+        record->value = reader->buffer[reader->pos++];
+    }
+
+    reader->last = *record;
+    return 1;
+}
+
+void trace_reader_close(struct trace_reader *reader) {
+    fclose(reader->f);
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/audio.c"
+
+#define TEST_SAMPLE_RATE 44100
+#define TEST_TIME 1000.0  // seconds, any clock
+#define TEST_BUFFER_SAMPLES 512
+
+// Test: Exactly `len` bytes are written, whole samples only
+void test_audio_fill_len(void) {
+    uint8_t stream[64];
+
+    audio_init(TEST_SAMPLE_RATE);
+    for (int len = 0; len <= 32; len++) {
+        memset(stream, 0xAA, sizeof(stream));
+        audio_fill(stream, len, TEST_TIME + len);
+        for (int i = len - len % (int) sizeof(float); i < (int) sizeof(stream); i++) {
+            assert(stream[i] == 0xAA);
+        }
+    }
+
+    printf("[PASS] test_audio_fill_len\n");
+}
+
+// Test: The wavetable oscillator follows a 440 Hz sine
+void test_audio_tone(void) {
+    float samples[TEST_SAMPLE_RATE / 10];
+    int crossings = 0;
+
+    audio_init(TEST_SAMPLE_RATE);
+    audio_push(1, 0);  // on from the start
+    audio_fill((uint8_t *) samples, sizeof(samples), TEST_TIME);
+    for (int i = 0; i < TEST_SAMPLE_RATE / 10; i++) {
+        assert(fabsf(samples[i] - (float) sin(AUDIO_TWO_PI * AUDIO_TONE_HZ * i / TEST_SAMPLE_RATE)) < 0.01f);
+        crossings += i > 0 && samples[i - 1] < 0 && samples[i] >= 0;
+    }
+    assert(crossings >= AUDIO_TONE_HZ / 10 - 1 && crossings <= AUDIO_TONE_HZ / 10);
+
+    printf("[PASS] test_audio_tone\n");
+}
+
+// Test: The phase wraps without drifting, e.g. after days of samples
+void test_audio_phase_wrap(void) {
+    float sample;
+
+    audio_init(TEST_SAMPLE_RATE);
+    audio_on = 1;
+    audio_phase = UINT32_MAX - audio_phase_step / 2;  // wraps within the next sample
+    audio_fill((uint8_t *) &sample, sizeof(sample), TEST_TIME);
+    assert(sample <= 0 && sample > -0.05f);
+    assert(audio_phase < audio_phase_step);
+    audio_fill((uint8_t *) &sample, sizeof(sample), TEST_TIME + 1.0 / TEST_SAMPLE_RATE);
+    assert(sample >= 0 && sample < 0.05f);
+
+    printf("[PASS] test_audio_phase_wrap\n");
+}
+
+// Test: Events gate the beep at the sample matching their time, and a full
+// queue drops events rather than blocking
+void test_audio_gate(void) {
+    float samples[64];
+
+    // 1. On, off, on within one buffer, half a sample after samples 10, 30, 50
+    audio_init(TEST_SAMPLE_RATE);
+    audio_fill((uint8_t *) samples, sizeof(samples), TEST_TIME);
+    audio_push(1, TEST_TIME + 10.5 / TEST_SAMPLE_RATE);
+    audio_push(0, TEST_TIME + 30.5 / TEST_SAMPLE_RATE);
+    audio_push(1, TEST_TIME + 50.5 / TEST_SAMPLE_RATE);
+    audio_fill((uint8_t *) samples, sizeof(samples), TEST_TIME + 64.0 / TEST_SAMPLE_RATE);
+    for (int i = 0; i < 64; i++) {
+        if (i <= 11 || (i >= 31 && i <= 51)) {
+            assert(samples[i] == 0);  // off, or on with the phase restarted
+        } else {
+            assert(samples[i] > 0);
+        }
+    }
+
+    // 2. Late events apply at the first sample of the next buffer
+    audio_push(0, TEST_TIME);
+    audio_fill((uint8_t *) samples, sizeof(samples), TEST_TIME + 128.0 / TEST_SAMPLE_RATE);
+    for (int i = 0; i < 64; i++) {
+        assert(samples[i] == 0);
+    }
+
+    // 3. Full queue
+    for (int i = 0; i < AUDIO_QUEUE_SIZE; i++) {
+        assert(audio_push(i & 1, TEST_TIME) == 0);
+    }
+    assert(audio_push(1, TEST_TIME) != 0);
+    assert(audio_events_dropped == 1);
+    audio_fill((uint8_t *) samples, sizeof(samples), TEST_TIME + 192.0 / TEST_SAMPLE_RATE);
+    assert(audio_push(1, TEST_TIME) == 0);
+
+    printf("[PASS] test_audio_gate\n");
+}
+
+// Test: The emulated clock follows a device that drifts from the wall clock,
+// waits for a stalled device and jumps forward after an underrun
+void test_audio_pace(void) {
+    float samples[TEST_BUFFER_SAMPLES];
+    double wall = TEST_TIME;
+    double start;
+    double clock;
+
+    audio_init(TEST_SAMPLE_RATE);
+    audio_pace_init(TEST_BUFFER_SAMPLES);
+    start = audio_pace(wall);
+    assert(start == (double) TEST_BUFFER_SAMPLES * AUDIO_PACE_TARGET_BUFFERS / TEST_SAMPLE_RATE);
+
+    // 1. Device 0.3% fast for a minute, polled 8 times per buffer: in the window, no underruns
+    for (int i = 0; i < 60 * TEST_SAMPLE_RATE / TEST_BUFFER_SAMPLES; i++) {
+        audio_fill_clocked((uint8_t *) samples, sizeof(samples));
+        for (int j = 0; j < 8; j++) {
+            wall += TEST_BUFFER_SAMPLES / 8.0 / TEST_SAMPLE_RATE / 1.003;
+            clock = audio_pace(wall);
+        }
+    }
+    assert(audio_underruns == 0);
+    assert(audio_depth_min >= 0 && audio_depth_max <= TEST_BUFFER_SAMPLES * AUDIO_PACE_MAX_BUFFERS);
+    assert(fabs(clock - start - (double) audio_clock / TEST_SAMPLE_RATE) < (double) TEST_BUFFER_SAMPLES * 2 / TEST_SAMPLE_RATE);
+
+    // 2. Stalled device: the clock stops at the furthest depth
+    wall += 1.0;
+    clock = audio_pace(wall);
+    assert(clock == (double) (audio_clock + TEST_BUFFER_SAMPLES * AUDIO_PACE_MAX_BUFFERS) / TEST_SAMPLE_RATE);
+    assert(audio_underruns == 0);
+
+    // 3. Device plays past the clock: an underrun, back to the target depth
+    for (int i = 0; i < AUDIO_PACE_MAX_BUFFERS + 1; i++) {
+        audio_fill_clocked((uint8_t *) samples, sizeof(samples));
+    }
+    clock = audio_pace(wall);
+    assert(audio_underruns == 1);
+    assert(clock == (double) (audio_clock + TEST_BUFFER_SAMPLES * AUDIO_PACE_TARGET_BUFFERS) / TEST_SAMPLE_RATE);
+
+    printf("[PASS] test_audio_pace\n");
+}
+
+int main(void) {
+    printf("* Running audio tests\n");
+    test_audio_fill_len();
+    test_audio_tone();
+    test_audio_phase_wrap();
+    test_audio_gate();
+    test_audio_pace();
+
+    printf("\n* All audio tests passed\n");
+    return 0;
+}
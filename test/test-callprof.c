@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+#include "../src/callprof.c"
+
+#define TEST_FOLDED_FILE "test-callstacks.folded"
+
+// 0x200: call 0x300, 0x300: call 0x340, 0x340: loop forever
+void load_nested_calls(void) {
+    chip8_init();
+    memory[0x200] = 0x23; memory[0x201] = 0x00;
+    memory[0x300] = 0x23; memory[0x301] = 0x40;
+    memory[0x340] = 0x13; memory[0x341] = 0x40;
+}
+
+// Test: Call stack is reported as subroutine entry addresses then pc
+void test_chip8_call_stack(void) {
+    uint16_t frames[CALLPROF_MAX_FRAMES];
+
+    load_nested_calls();
+    assert(chip8_call_stack(frames) == 1);
+    assert(frames[0] == 0x200);
+
+    chip8_step(0, 0);
+    chip8_step(0, 0);
+    assert(chip8_call_stack(frames) == 3);
+    assert(frames[0] == 0x300);
+    assert(frames[1] == 0x340);
+    assert(frames[2] == 0x340);
+
+    // Return addresses that do not follow a call are reported as they are
+    memory[0x200] = 0x00;
+    assert(chip8_call_stack(frames) == 3);
+    assert(frames[0] == 0x202);
+
+    printf("[PASS] test_chip8_call_stack\n");
+}
+
+// Test: Samples are aggregated per distinct stack and written folded
+void test_callprof_folded(void) {
+    char line[128];
+    FILE *f;
+
+    load_nested_calls();
+    callprof_init();
+    for (int i = 0; i < 100 * CALLPROF_INTERVAL; i++) {
+        chip8_step(0, 0);
+        callprof_step();
+    }
+
+    // 1. Roughly one sample per interval, all in the innermost loop
+    assert(callprof_samples > 50 && callprof_samples < 200);
+    assert(callprof_stacks_used == 1);
+
+    // 2. Folded output
+    assert(callprof_write(TEST_FOLDED_FILE) == 0);
+    f = fopen(TEST_FOLDED_FILE, "r");
+    assert(f);
+    assert(fgets(line, sizeof(line), f));
+    assert(strncmp(line, "main;sub_300;sub_340;pc_340 ", 28) == 0);
+    assert((uint64_t) atoll(&line[28]) == callprof_samples);
+    assert(!fgets(line, sizeof(line), f));
+    fclose(f);
+    remove(TEST_FOLDED_FILE);
+
+    printf("[PASS] test_callprof_folded\n");
+}
+
+int main(void) {
+    printf("* Running call stack profiler tests\n");
+    test_chip8_call_stack();
+    test_callprof_folded();
+
+    printf("\n* All call stack profiler tests passed\n");
+    return 0;
+}
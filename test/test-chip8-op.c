@@ -2,6 +2,7 @@
 #include <assert.h>
 
 #include "../src/chip8.c"
+#include "../src/logger.c"
 
 void test_chip8_init() {
     chip8_init();
@@ -671,6 +672,7 @@ void test_8XY6_modern() {
     // 1.
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_SHIFT;  // disable legacy shift mode
+    chip8_select_quirks();
     V[0x0] = 0b10101010;
     memory[PROG_START_ADDR]     = 0x80;
     memory[PROG_START_ADDR + 1] = 0x16;
@@ -681,6 +683,7 @@ void test_8XY6_modern() {
     // 2.
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_SHIFT;  // disable legacy shift mode
+    chip8_select_quirks();
     V[0x0] = 0b11111111;
     memory[PROG_START_ADDR]     = 0x80;
     memory[PROG_START_ADDR + 1] = 0x16;
@@ -691,6 +694,7 @@ void test_8XY6_modern() {
     // 3. Ensure VF can be used as VY
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_SHIFT;  // disable legacy shift mode
+    chip8_select_quirks();
     V[0xF] = 0b11111111;
     memory[PROG_START_ADDR]     = 0x8F;
     memory[PROG_START_ADDR + 1] = 0x06;
@@ -792,6 +796,7 @@ void test_8XYE_modern() {
     // 1.
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_SHIFT;
+    chip8_select_quirks();
     V[0x0] = 0b01010101;
     memory[PROG_START_ADDR]     = 0x80;
     memory[PROG_START_ADDR + 1] = 0x0E;
@@ -802,6 +807,7 @@ void test_8XYE_modern() {
     // 2.
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_SHIFT;
+    chip8_select_quirks();
     V[0x0] = 0b11111111;
     V[0x1] = 0b00000000;
     memory[PROG_START_ADDR]     = 0x80;
@@ -813,6 +819,7 @@ void test_8XYE_modern() {
     // 3. Ensure VF can be used as VX
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_SHIFT;
+    chip8_select_quirks();
     V[0xF] = 0b11111111;
     memory[PROG_START_ADDR]     = 0x8F;
     memory[PROG_START_ADDR + 1] = 0x0E;
@@ -1241,6 +1248,7 @@ void test_FX55_modern() {
     // 1. Write up to the 0th index
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_REG_DUMP_I;  // disable legacy
+    chip8_select_quirks();
     V[0x0] = 44;
     V[0x1] = 55;
     V[0x2] = 66;
@@ -1256,6 +1264,7 @@ void test_FX55_modern() {
     // 2. Write up to the 2nd index
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_REG_DUMP_I;  // disable legacy
+    chip8_select_quirks();
     V[0x0] = 44;
     V[0x1] = 55;
     V[0x2] = 66;
@@ -1335,6 +1344,7 @@ void test_FX65_modern() {
     // 1. Load up to the 0th register
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_REG_DUMP_I;  // disable legacy
+    chip8_select_quirks();
     I = 0x300;
     memory[PROG_START_ADDR]     = 0xF0;
     memory[PROG_START_ADDR + 1] = 0x65;
@@ -1350,6 +1360,7 @@ void test_FX65_modern() {
     // 2. Load up to the 2nd register
     chip8_init();
     chip8_quirk_flag ^= CHIP8_QUIRK_LEGACY_REG_DUMP_I;  // disable legacy
+    chip8_select_quirks();
     I = 0x300;
     memory[PROG_START_ADDR]     = 0xF2;
     memory[PROG_START_ADDR + 1] = 0x65;
@@ -1365,6 +1376,147 @@ void test_FX65_modern() {
     printf("[PASS] test_FX65_modern\n");
 }
 
+uint16_t observed_addr;
+uint16_t observed_len;
+int observed_calls;
+
+void test_observer(uint16_t addr, uint16_t len) {
+    observed_addr = addr;
+    observed_len = len;
+    observed_calls++;
+}
+
+void test_write_observer() {
+    uint8_t snapshot[CHIP8_SNAPSHOT_SIZE];
+    uint32_t generation;
+
+    // 1. Guest writes are reported per byte and bump the page generation
+    chip8_init();
+    assert(chip8_add_write_observer(&test_observer) == 0);
+    observed_calls = 0;
+    generation = chip8_page_generation[0x3];
+    I = 0x300;
+    V[0x0] = 123;
+    memory[PROG_START_ADDR]     = 0xF0;
+    memory[PROG_START_ADDR + 1] = 0x33;
+    chip8_step(0, 0.0);
+    assert(observed_calls == 3);
+    assert(observed_addr == 0x302 && observed_len == 1);
+    assert(chip8_page_generation[0x3] == generation + 3);
+    assert(memory[0x300] == 1 && memory[0x301] == 2 && memory[0x302] == 3);
+
+    // 2. Writes past the end of memory wrap around
+    I = 0xFFF;
+    V[0x1] = 0xAB;
+    memory[PROG_START_ADDR + 2] = 0xF1;
+    memory[PROG_START_ADDR + 3] = 0x55;
+    chip8_step(0, 0.0);
+    assert(memory[0xFFF] == 123 && memory[0x000] == 0xAB);
+    assert(observed_addr == 0x000);
+
+    // 3. Restoring a snapshot only reports the pages that change
+    chip8_snapshot(snapshot);
+    memory[0x7FF] = 0x55;  // not through the write path
+    observed_calls = 0;
+    generation = chip8_page_generation[0x7];
+    chip8_restore(snapshot);
+    assert(observed_calls == 1);
+    assert(observed_addr == 0x700 && observed_len == CHIP8_PAGE_SIZE);
+    assert(chip8_page_generation[0x7] == generation + 1);
+    assert(memory[0x7FF] == 0);
+
+    // 4. Removed observers are no longer called
+    chip8_remove_write_observer(&test_observer);
+    observed_calls = 0;
+    chip8_mem_write(0x400, 1);
+    assert(observed_calls == 0);
+
+    printf("[PASS] test_write_observer\n");
+}
+
+// Test: Sprites redrawn after their memory is written are not drawn stale
+void test_sprite_cache() {
+    chip8_init();
+    low_res_mode = 0;
+    I = 0x300;
+    V[0x0] = 0xF0;
+    V[0x1] = 0x0F;
+    chip8_mem_write(0x300, 0xAA);
+    chip8_mem_write(0x301, 0x55);
+
+    // 1. Draw and undraw the same sprite at (0, 0)
+    decode_and_exec(0xD232, 0);
+    assert(chip8_display[0] == 1 && chip8_display[1] == 0);
+    assert(chip8_display[DISPLAY_RES_X + 1] == 1);
+    decode_and_exec(0xD232, 0);
+    assert(V[0xF] == 8);
+    for (int i = 0; i < DISPLAY_RES_X * DISPLAY_RES_Y; i++) {
+        assert(chip8_display[i] == 0);
+    }
+
+    // 2. Rewrite the sprite through FX55 and draw it again
+    memory[PROG_START_ADDR]     = 0xF1;
+    memory[PROG_START_ADDR + 1] = 0x55;
+    chip8_step(0, 0.0);
+    I = 0x300;
+    decode_and_exec(0xD232, 0);
+    assert(chip8_display[0] == 1 && chip8_display[4] == 0 && chip8_display[7] == 0);
+    assert(chip8_display[DISPLAY_RES_X] == 0 && chip8_display[DISPLAY_RES_X + 7] == 1);
+
+    // 3. A sprite across a page boundary, rewritten in its second page
+    memset(chip8_display, 0, DISPLAY_RES_X * DISPLAY_RES_Y);
+    I = 0x3FF;
+    decode_and_exec(0xD232, 0);
+    chip8_mem_write(0x400, 0xFF);
+    decode_and_exec(0xD232, 0);
+    assert(chip8_display[0] == 0 && chip8_display[DISPLAY_RES_X + 7] == 1);
+
+    // 4. I past the end of memory (legacy FX55/FX65) wraps, for both the bytes
+    // and the pages that validate them
+    memset(chip8_display, 0, DISPLAY_RES_X * DISPLAY_RES_Y);
+    I = TOTAL_MEMORY + 0x300;
+    decode_and_exec(0xD231, 0);
+    chip8_mem_write(0x300, 0x01);
+    decode_and_exec(0xD231, 0);
+    assert(chip8_display[0] == 1 && chip8_display[7] == 1);
+
+    printf("[PASS] test_sprite_cache\n");
+}
+
+// Test: Display hashes only depend on the pixels
+void test_display_hash() {
+    uint8_t copy[DISPLAY_RES_X * DISPLAY_RES_Y];
+    uint64_t blank;
+    uint64_t hash;
+
+    // 1. Equal displays hash equal
+    chip8_init();
+    blank = chip8_display_hash(chip8_display);
+    memset(copy, 0, sizeof(copy));
+    assert(chip8_display_hash(copy) == blank);
+
+    // 2. Any single pixel changes the hash, and undoing it restores the hash
+    for (int i = 0; i < DISPLAY_RES_X * DISPLAY_RES_Y; i++) {
+        chip8_display[i] = 1;
+        hash = chip8_display_hash(chip8_display);
+        assert(hash != blank);
+        chip8_display[i ^ 1] ^= 1;  // a neighbouring pixel also on
+        assert(chip8_display_hash(chip8_display) != hash);
+        chip8_display[i ^ 1] ^= 1;
+        chip8_display[i] = 0;
+    }
+    assert(chip8_display_hash(chip8_display) == blank);
+
+    // 3. A sprite drawn and erased leaves the hash unchanged
+    I = FONT_START_ADDR;
+    decode_and_exec(0xD005, 0);
+    assert(chip8_display_hash(chip8_display) != blank);
+    decode_and_exec(0xD005, 0);
+    assert(chip8_display_hash(chip8_display) == blank);
+
+    printf("[PASS] test_display_hash\n");
+}
+
 int main(void) {
     printf("* Beginning chip-8 init test\n");
     test_chip8_init();
@@ -1409,6 +1561,13 @@ int main(void) {
     test_FX55_modern();  // Dump reg to memory at I (I not updated)
     test_FX65_modern();  // Load reg from memory at I (I not updated)
 
+    printf("\n* Beginning memory write path tests\n");
+    test_write_observer();  // Observers and page generations
+    test_sprite_cache();  // Expanded sprites invalidated by writes
+
+    printf("\n* Beginning display hash tests\n");
+    test_display_hash();  // Hashes of equal displays are equal
+
     printf("\n* All CHIP8 op tests passed\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+#include "../src/coverage.c"
+
+#define TEST_COVERAGE_FILE "test-coverage.txt"
+
+// Test: Instructions are disassembled, unrecognised ones as data
+void test_chip8_disassemble(void) {
+    char buffer[CHIP8_DISASSEMBLY_LEN];
+
+    chip8_disassemble(0x00E0, buffer);
+    assert(strcmp(buffer, "CLS") == 0);
+    chip8_disassemble(0x8124, buffer);
+    assert(strcmp(buffer, "ADD V1, V2") == 0);
+    chip8_disassemble(0xDAB5, buffer);
+    assert(strcmp(buffer, "DRW VA, VB, 5") == 0);
+    chip8_disassemble(0xA2F0, buffer);
+    assert(strcmp(buffer, "LD I, 2F0") == 0);
+    chip8_disassemble(0xF355, buffer);
+    assert(strcmp(buffer, "LD [I], V3") == 0);
+    chip8_disassemble(0xFFFF, buffer);
+    assert(strcmp(buffer, "DW FFFF") == 0);
+
+    printf("[PASS] test_chip8_disassemble\n");
+}
+
+// Test: Executed, read and written addresses are marked
+void test_coverage_bitmaps(void) {
+    uint8_t program[] = {
+        0xA3, 0x00,  // 200: LD I, 300
+        0xF1, 0x55,  // 202: LD [I], V1  (writes 300-301)
+        0xF2, 0x65,  // 204: LD V2, [I]  (reads 300-302)
+        0xD0, 0x04,  // 206: DRW V0, V0, 4  (reads 300-303)
+        0x12, 0x08,  // 208: JP 208
+        0x12, 0x00,  // 20a: never executed
+    };
+
+    chip8_init();
+    memcpy(&memory[PROG_START_ADDR], program, sizeof(program));
+    chip8_rom_size = sizeof(program);
+    chip8_quirk_flag = CHIP8_QUIRK_MODERN_MODE;  // I unchanged by FX55/FX65
+    chip8_select_quirks();
+    for (int i = 0; i < 10; i++) {
+        chip8_step(0, 0);
+    }
+
+    // 1. Executed
+    for (uint16_t addr = 0x200; addr <= 0x208; addr += 2) {
+        assert(CHIP8_COVERED(chip8_coverage_exec, addr));
+        assert(!CHIP8_COVERED(chip8_coverage_exec, addr + 1));
+    }
+    assert(!CHIP8_COVERED(chip8_coverage_exec, 0x20A));
+
+    // 2. Read and written
+    for (uint16_t addr = 0x300; addr < 0x304; addr++) {
+        assert(CHIP8_COVERED(chip8_coverage_read, addr));
+        assert(CHIP8_COVERED(chip8_coverage_write, addr) == (addr < 0x302));
+    }
+    assert(!CHIP8_COVERED(chip8_coverage_read, 0x304));
+
+    // 3. Cleared on init
+    chip8_init();
+    assert(!CHIP8_COVERED(chip8_coverage_exec, 0x200));
+    assert(!CHIP8_COVERED(chip8_coverage_read, 0x300));
+    assert(!CHIP8_COVERED(chip8_coverage_write, 0x300));
+
+    printf("[PASS] test_coverage_bitmaps\n");
+}
+
+// Test: Report overlays the marks on a disassembly of the ROM
+void test_coverage_report(void) {
+    uint8_t program[] = {
+        0x13, 0x01,  // 200: JP 301
+        0x00, 0xE0,  // 202: never executed
+    };
+    char line[128];
+    uint8_t found = 0;
+    FILE *f;
+
+    chip8_init();
+    memcpy(&memory[PROG_START_ADDR], program, sizeof(program));
+    memory[0x301] = 0x13;  // 301: JP 301, outside of the ROM and unaligned
+    memory[0x302] = 0x01;
+    chip8_rom_size = sizeof(program);
+    for (int i = 0; i < 3; i++) {
+        chip8_step(0, 0);
+    }
+
+    assert(coverage_write(TEST_COVERAGE_FILE) == 0);
+    f = fopen(TEST_COVERAGE_FILE, "r");
+    assert(f);
+    while (fgets(line, sizeof(line), f)) {
+        found += strcmp(line, "executed:  1 instructions (50.0% of ROM)\n") == 0;
+        found += strcmp(line, "200  1301  X..  JP 301\n") == 0;
+        found += strcmp(line, "202  00e0  ...  CLS\n") == 0;
+        found += strcmp(line, "301  1301  X..  JP 301\n") == 0;
+    }
+    fclose(f);
+    remove(TEST_COVERAGE_FILE);
+    assert(found == 4);
+
+    printf("[PASS] test_coverage_report\n");
+}
+
+int main(void) {
+    printf("* Running coverage tests\n");
+    test_chip8_disassemble();
+    test_coverage_bitmaps();
+    test_coverage_report();
+
+    printf("\n* All coverage tests passed\n");
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+#include "../src/debugger.c"
+
+// Feed debugger commands from a temporary file
+void debugger_commands(const char *commands) {
+    if (debugger_input) {
+        fclose(debugger_input);
+    }
+    debugger_input = tmpfile();
+    assert(debugger_input);
+    fputs(commands, debugger_input);
+    rewind(debugger_input);
+}
+
+// 0x200: V0 += 1, 0x202: LD [I], V0, 0x204: JP 0x200, with I = 0x300
+void load_counter(void) {
+    chip8_init();
+    memset(debugger_breakpoints, 0, sizeof(debugger_breakpoints));
+    memset(debugger_watchpoints, 0, sizeof(debugger_watchpoints));
+    memory[0x200] = 0x70; memory[0x201] = 0x01;
+    memory[0x202] = 0xF0; memory[0x203] = 0x55;
+    memory[0x204] = 0x12; memory[0x205] = 0x00;
+    I = 0x300;
+    chip8_quirk_flag = CHIP8_QUIRK_MODERN_MODE;
+    chip8_select_quirks();
+}
+
+// Test: Stepping runs the requested number of instructions between prompts
+void test_debugger_step(void) {
+    load_counter();
+    debugger_commands("s 3\ns\n");
+    debugger_init();
+
+    // 1. Prompt, then 3 steps without prompting
+    assert(debugger_step(0, 0) == 1);
+    assert(debugger_step(0, 0) == 0);
+    assert(debugger_step(0, 0) == 0);
+    assert(V[0x0] == 1 && pc == 0x200);
+
+    // 2. Prompt again for the single step
+    assert(debugger_step(0, 0) == 1);
+    assert(V[0x0] == 2);
+
+    // 3. End of input quits
+    assert(debugger_step(0, 0) == 1);
+    assert(chip8_exit_flag == 1);
+    assert(V[0x0] == 2);
+
+    printf("[PASS] test_debugger_step\n");
+}
+
+// Test: Continue runs without prompting until a breakpoint
+void test_debugger_breakpoint(void) {
+    load_counter();
+    debugger_commands("b 204\nc\nb 204\nc\n");
+    debugger_init();
+
+    // 1. Stop at the breakpoint, before executing it
+    assert(debugger_step(0, 0) == 1);
+    assert(debugger_step(0, 0) == 0);
+    assert(pc == 0x204);
+    assert(debugger_step(0, 0) == 1);
+    assert(pc == 0x200);
+
+    // 2. Cleared breakpoints no longer stop
+    for (int i = 0; i < 30; i++) {
+        assert(debugger_step(0, 0) == 0);
+    }
+    assert(V[0x0] == 11);
+    assert(chip8_exit_flag == 0);
+
+    printf("[PASS] test_debugger_breakpoint\n");
+}
+
+// Test: Writes to watched memory stop before the next instruction
+void test_debugger_watchpoint(void) {
+    uint8_t state[CHIP8_SNAPSHOT_SIZE];
+
+    load_counter();
+    debugger_commands("w 2ff 2\nc\nq\n");
+    debugger_init();
+
+    assert(debugger_step(0, 0) == 1);
+    assert(debugger_step(0, 0) == 0);
+    assert(memory[0x300] == 1);
+    assert(debugger_stopped == 1);
+    assert(debugger_watch_hit == 0);
+
+    // Quit from the prompt
+    assert(debugger_step(0, 0) == 1);
+    assert(chip8_exit_flag == 1);
+    assert(pc == 0x204);
+
+    // A restore (rewind or state load) changing the watched page is not a guest write
+    load_counter();
+    debugger_commands("w 3f0 1\nc\n");
+    debugger_init();
+    assert(debugger_step(0, 0) == 1);
+    chip8_snapshot(state);
+    memory[0x3F0] = 0x55;
+    chip8_restore(state);
+    debugger_reset_history();
+    assert(debugger_step(0, 0) == 0);
+    assert(debugger_stopped == 0);
+
+    printf("[PASS] test_debugger_watchpoint\n");
+}
+
+// 0x200: V1 = random, V0 += V1, V2 = DT, V0 += V2, DT = V3 when it runs out, V4 = key (skips)
+void load_nondeterministic(void) {
+    uint8_t program[] = {
+        0xC1, 0xFF,  // 200: RND V1, FF
+        0x80, 0x14,  // 202: ADD V0, V1
+        0xF2, 0x07,  // 204: LD V2, DT
+        0x80, 0x24,  // 206: ADD V0, V2
+        0x63, 0x05,  // 208: LD V3, 05
+        0x32, 0x00,  // 20a: SE V2, 00
+        0x12, 0x10,  // 20c: JP 210
+        0xF3, 0x15,  // 20e: LD DT, V3
+        0xE5, 0x9E,  // 210: SKP V5
+        0x74, 0x01,  // 212: ADD V4, 01
+        0x12, 0x00,  // 214: JP 200
+    };
+
+    chip8_init();
+    memset(debugger_breakpoints, 0, sizeof(debugger_breakpoints));
+    memset(debugger_watchpoints, 0, sizeof(debugger_watchpoints));
+    memcpy(&memory[PROG_START_ADDR], program, sizeof(program));
+    chip8_next_timer_update = 0;
+}
+
+uint32_t state_hash(void) {
+    uint8_t state[CHIP8_SNAPSHOT_SIZE];
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    chip8_snapshot(state);
+    for (int i = 0; i < CHIP8_SNAPSHOT_SIZE; i++) {
+        hash = (hash ^ state[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+#define REVERSE_TEST_STEPS 3000
+uint32_t reverse_test_hashes[REVERSE_TEST_STEPS + 1];
+
+// Test: Re-execution from keyframes reproduces the recorded history exactly
+void test_debugger_reverse(void) {
+    uint64_t seek_targets[] = {2999, 2500, 1024, 1023, 77, 0, 3000};
+    uint64_t end;
+
+    load_nondeterministic();
+    debugger_commands("c\n");
+    debugger_init();
+    debugger_keyframe_interval = 100;
+
+    // 1. Record, with timers ticking irregularly and a key pressed at times
+    for (int i = 0; i < REVERSE_TEST_STEPS; i++) {
+        reverse_test_hashes[i] = state_hash();
+        debugger_step(i % 7 == 0 ? 0x5 : 0x0, i * 0.004 + (i % 13) * 0.001);
+    }
+    reverse_test_hashes[REVERSE_TEST_STEPS] = state_hash();
+    end = chip8_cycles;
+    assert(end == REVERSE_TEST_STEPS);
+
+    // 2. Seek anywhere in the history
+    for (unsigned long i = 0; i < sizeof(seek_targets) / sizeof(seek_targets[0]); i++) {
+        assert(debugger_seek(seek_targets[i]) == 0);
+        assert(chip8_cycles == seek_targets[i]);
+        assert(state_hash() == reverse_test_hashes[seek_targets[i]]);
+    }
+    assert(debugger_seek(end + 1) != 0);
+
+    // 3. Stepping forward after reversing re-executes the logged input, not the live one
+    assert(debugger_seek(1500) == 0);
+    for (int i = 1500; i < 1600; i++) {
+        debugger_step(0xF, 1e9);
+        assert(state_hash() == reverse_test_hashes[i + 1]);
+    }
+
+    // 4. Reverse steps
+    debugger_reverse_step(1);
+    assert(chip8_cycles == 1599);
+    assert(state_hash() == reverse_test_hashes[1599]);
+    debugger_reverse_step(599);
+    assert(chip8_cycles == 1000);
+    assert(state_hash() == reverse_test_hashes[1000]);
+    debugger_reverse_step(100000);
+    assert(chip8_cycles == 0);
+
+    // 5. Reverse continue to the last time DT was reloaded before instruction 2000
+    assert(debugger_seek(2000) == 0);
+    debugger_toggle_breakpoint(0x20E);
+    debugger_reverse_continue();
+    assert(chip8_pc() == 0x20E);
+    assert(chip8_cycles < 2000);
+    for (uint64_t cycle = chip8_cycles + 1; cycle < 2000; cycle++) {
+        assert(debugger_seek(cycle) == 0);
+        assert(chip8_pc() != 0x20E);
+    }
+
+    printf("[PASS] test_debugger_reverse\n");
+}
+
+// Test: History is bounded by the number of keyframes and the input log
+void test_debugger_reverse_bounded(void) {
+    load_nondeterministic();
+    debugger_commands("c\n");
+    debugger_init();
+    debugger_keyframe_interval = DEBUGGER_LOG_SIZE / 16;
+
+    for (int i = 0; i < DEBUGGER_LOG_SIZE * 2; i++) {
+        debugger_step(0, i * 0.002);
+    }
+    assert(debugger_history_start() >= (uint64_t) DEBUGGER_LOG_SIZE);
+    assert(debugger_seek(debugger_history_start()) == 0);
+    assert(debugger_seek(DEBUGGER_LOG_SIZE - 1) != 0);
+
+    printf("[PASS] test_debugger_reverse_bounded\n");
+}
+
+int main(void) {
+    printf("* Running debugger tests\n");
+    test_debugger_step();
+    test_debugger_breakpoint();
+    test_debugger_watchpoint();
+    test_debugger_reverse();
+    test_debugger_reverse_bounded();
+
+    printf("\n* All debugger tests passed\n");
+    return 0;
+}
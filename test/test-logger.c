@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+
+// Test: Unrecognised instructions are counted and queued, not printed
+void test_logger_unrecognised(void) {
+    // 1. Executing an unrecognised instruction
+    chip8_init();
+    logger_init();
+    memory[PROG_START_ADDR]     = 0x80;
+    memory[PROG_START_ADDR + 1] = 0x0F;
+    chip8_step(0, 0.0);
+    assert(logger_counts[0x800F] == 1);
+    assert(logger_first_addr[0x800F] == PROG_START_ADDR);
+    assert(logger_head - logger_tail == 1);
+    assert(logger_ring[0].instruction == 0x800F);
+    assert(logger_ring[0].addr == PROG_START_ADDR);
+
+    // 2. Recognised instructions are not logged
+    memory[PROG_START_ADDR + 2] = 0x60;
+    memory[PROG_START_ADDR + 3] = 0x01;
+    chip8_step(0, 0.0);
+    assert(logger_head - logger_tail == 1);
+
+    printf("[PASS] test_logger_unrecognised\n");
+}
+
+// Test: A full ring drops records, flushing prints a limited amount
+void test_logger_rate_limit(void) {
+    logger_init();
+
+    // 1. Ring fills up
+    for (int i = 0; i < LOGGER_RING_SIZE + 10; i++) {
+        logger_unrecognised(0xFFFF, PROG_START_ADDR + i);
+    }
+    assert(logger_counts[0xFFFF] == LOGGER_RING_SIZE + 10);
+    assert(logger_first_addr[0xFFFF] == PROG_START_ADDR);
+    assert(logger_head - logger_tail == LOGGER_RING_SIZE);
+    assert(logger_suppressed == 10);
+
+    // 2. Flush empties the ring, counters are kept for the summary
+    logger_flush();
+    assert(logger_head == logger_tail);
+    assert(logger_suppressed == 0);
+    assert(logger_counts[0xFFFF] == LOGGER_RING_SIZE + 10);
+
+    // 3. Ring is usable again after a flush
+    logger_unrecognised(0xFFFE, 0x300);
+    assert(logger_head - logger_tail == 1);
+
+    printf("[PASS] test_logger_rate_limit\n");
+}
+
+int main(void) {
+    printf("* Running logger tests\n");
+    test_logger_unrecognised();
+    test_logger_rate_limit();
+
+    printf("\n* All logger tests passed\n");
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/pixel.c"
+
+#define TEST_PITCH_PADDING 16  // texels of padding per row, as a texture may have
+
+uint8_t test_display[DISPLAY_RES_X * DISPLAY_RES_Y];
+uint8_t test_last_frame[DISPLAY_RES_X * DISPLAY_RES_Y];
+uint32_t test_texels[DISPLAY_RES_Y][DISPLAY_RES_X + TEST_PITCH_PADDING];
+
+// Fill both frames with a pattern that differs between them and across rows
+void fill_frames(void) {
+    for (int i = 0; i < DISPLAY_RES_X * DISPLAY_RES_Y; i++) {
+        test_display[i] = (i * 7 + i / DISPLAY_RES_X) % 3 == 0;
+        test_last_frame[i] = (i * 5) % 7 == 0;
+    }
+}
+
+// Check every texel against the expected colour, and the padding is untouched
+void check_texels(const uint8_t *last_frame) {
+    uint8_t on;
+
+    for (int y = 0; y < DISPLAY_RES_Y; y++) {
+        for (int x = 0; x < DISPLAY_RES_X; x++) {
+            on = test_display[y * DISPLAY_RES_X + x];
+            on |= last_frame && last_frame[y * DISPLAY_RES_X + x];
+            assert(test_texels[y][x] == (on ? PIXEL_ON : PIXEL_OFF));
+        }
+        for (int x = DISPLAY_RES_X; x < DISPLAY_RES_X + TEST_PITCH_PADDING; x++) {
+            assert(test_texels[y][x] == 0);
+        }
+    }
+}
+
+// Test: Single and double buffered expansion into a padded texture
+void test_pixel_expand(void) {
+    uint8_t last_frame[DISPLAY_RES_X * DISPLAY_RES_Y];
+
+    fill_frames();
+
+    // 1. Single buffering: only the display
+    memset(test_texels, 0, sizeof(test_texels));
+    pixel_expand(&test_texels[0][0], sizeof(test_texels[0]), test_display, NULL);
+    check_texels(NULL);
+
+    // 2. Double buffering: display OR last frame, which becomes the display
+    memcpy(last_frame, test_last_frame, sizeof(last_frame));
+    memset(test_texels, 0, sizeof(test_texels));
+    pixel_expand(&test_texels[0][0], sizeof(test_texels[0]), test_display, last_frame);
+    check_texels(test_last_frame);
+    assert(memcmp(last_frame, test_display, sizeof(last_frame)) == 0);
+
+    printf("[PASS] test_pixel_expand\n");
+}
+
+// Test: Every row kernel in this build matches the scalar kernel
+void test_pixel_kernels(void) {
+    uint32_t expected[DISPLAY_RES_X];
+    uint32_t actual[DISPLAY_RES_X];
+    uint8_t stored[DISPLAY_RES_X];
+
+    (void) actual;  // unused when only the scalar kernel is built
+    (void) stored;
+    fill_frames();
+    for (int y = 0; y < DISPLAY_RES_Y; y++) {
+        pixel_expand_row_scalar(expected, &test_display[y * DISPLAY_RES_X], &test_last_frame[y * DISPLAY_RES_X], NULL);
+#if defined(__SSE2__)
+        memset(stored, 0, sizeof(stored));
+        pixel_expand_row_sse2(actual, &test_display[y * DISPLAY_RES_X], &test_last_frame[y * DISPLAY_RES_X], stored);
+        assert(memcmp(expected, actual, sizeof(actual)) == 0);
+        assert(memcmp(stored, &test_display[y * DISPLAY_RES_X], sizeof(stored)) == 0);
+#endif
+#if defined(__AVX2__)
+        memset(stored, 0, sizeof(stored));
+        pixel_expand_row_avx2(actual, &test_display[y * DISPLAY_RES_X], &test_last_frame[y * DISPLAY_RES_X], stored);
+        assert(memcmp(expected, actual, sizeof(actual)) == 0);
+        assert(memcmp(stored, &test_display[y * DISPLAY_RES_X], sizeof(stored)) == 0);
+#endif
+    }
+
+    printf("[PASS] test_pixel_kernels\n");
+}
+
+// Test: Pixels turned off fade out, and the kernels agree
+void test_pixel_phosphor(void) {
+    uint8_t intensity[DISPLAY_RES_X * DISPLAY_RES_Y];
+    uint8_t scalar_intensity[DISPLAY_RES_X * DISPLAY_RES_Y];
+    uint32_t scalar_texels[DISPLAY_RES_X];
+    uint8_t level = 0xFF;
+
+    // 1. A pixel on, then off until it has faded
+    memset(intensity, 0, sizeof(intensity));
+    memset(test_display, 0, sizeof(test_display));
+    test_display[DISPLAY_RES_X + 3] = 1;
+    assert(pixel_expand_phosphor(&test_texels[0][0], sizeof(test_texels[0]), test_display, intensity, PIXEL_PHOSPHOR_DECAY) == 0);
+    assert(test_texels[1][3] == PIXEL_ON);
+    assert(test_texels[1][2] == PIXEL_OFF);
+
+    test_display[DISPLAY_RES_X + 3] = 0;
+    while (level) {
+        level = level > PIXEL_PHOSPHOR_DECAY ? level - PIXEL_PHOSPHOR_DECAY : 0;
+        assert(pixel_expand_phosphor(&test_texels[0][0], sizeof(test_texels[0]), test_display, intensity, PIXEL_PHOSPHOR_DECAY) == (level != 0));
+        assert(test_texels[1][3] == (PIXEL_OFF | level * 0x010101));
+    }
+
+    // 2. The scalar kernel gives the same intensities and texels
+    fill_frames();
+    for (int i = 0; i < DISPLAY_RES_X * DISPLAY_RES_Y; i++) {
+        intensity[i] = test_last_frame[i] * 0xA0 + (i & 0x1F);  // partly faded
+        scalar_intensity[i] = intensity[i];
+    }
+    pixel_expand_phosphor(&test_texels[0][0], sizeof(test_texels[0]), test_display, intensity, PIXEL_PHOSPHOR_DECAY);
+    for (int y = 0; y < DISPLAY_RES_Y; y++) {
+        pixel_phosphor_row_scalar(scalar_texels, &test_display[y * DISPLAY_RES_X],
+            &scalar_intensity[y * DISPLAY_RES_X], PIXEL_PHOSPHOR_DECAY);
+        assert(memcmp(scalar_texels, test_texels[y], sizeof(scalar_texels)) == 0);
+    }
+    assert(memcmp(scalar_intensity, intensity, sizeof(intensity)) == 0);
+
+    printf("[PASS] test_pixel_phosphor\n");
+}
+
+int main(void) {
+    printf("* Running pixel expansion tests\n");
+    test_pixel_expand();
+    test_pixel_kernels();
+    test_pixel_phosphor();
+
+    printf("\n* All pixel expansion tests passed\n");
+    return 0;
+}
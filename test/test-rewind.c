@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+#include "../src/rewind.c"
+
+// Test: Snapshot and restore round trip
+void test_snapshot_restore(void) {
+    uint8_t buffer[CHIP8_SNAPSHOT_SIZE];
+
+    chip8_init();
+    V[0x3] = 0x42;
+    pc = 0x345;
+    I = 0x123;
+    sp = 2;
+    stack[1] = 0x2AA;
+    memory[0xFFF] = 0x99;
+    chip8_display[DISPLAY_RES_X * DISPLAY_RES_Y - 1] = 1;
+    low_res_mode = 0;
+    chip8_snapshot(buffer);
+
+    chip8_init();
+    chip8_restore(buffer);
+    assert(V[0x3] == 0x42);
+    assert(pc == 0x345);
+    assert(I == 0x123);
+    assert(sp == 2);
+    assert(stack[1] == 0x2AA);
+    assert(memory[0xFFF] == 0x99);
+    assert(chip8_display[DISPLAY_RES_X * DISPLAY_RES_Y - 1] == 1);
+    assert(low_res_mode == 0);
+    assert(chip8_display_updated == 1);
+
+    printf("[PASS] test_snapshot_restore\n");
+}
+
+// Test: Step back through recorded frames
+void test_rewind_step(void) {
+    chip8_init();
+    rewind_init();
+
+    // 1. Nothing to rewind to
+    assert(rewind_step() != 0);
+    rewind_push();
+    assert(rewind_frames_available() == 0);
+    assert(rewind_step() != 0);
+
+    // 2. Frames are restored newest first
+    for (int i = 1; i <= 5; i++) {
+        V[0x0] = i;
+        pc = PROG_START_ADDR + i * 2;
+        chip8_display[i * 100] = 1;
+        rewind_push();
+    }
+    assert(rewind_frames_available() == 5);
+    for (int i = 4; i >= 0; i--) {
+        assert(rewind_step() == 0);
+        assert(V[0x0] == i);
+        assert(pc == PROG_START_ADDR + i * 2);
+        assert(chip8_display[(i + 1) * 100] == 0);
+    }
+    assert(rewind_step() != 0);
+
+    // 3. Recording after rewinding continues from the restored frame
+    V[0x1] = 0xAB;
+    rewind_push();
+    assert(rewind_step() == 0);
+    assert(V[0x1] == 0);
+
+    printf("[PASS] test_rewind_step\n");
+}
+
+// Test: History is bounded to the most recent frames
+void test_rewind_bounded(void) {
+    uint16_t available;
+
+    chip8_init();
+    rewind_init();
+
+    // 1. Frame count bound
+    for (int i = 0; i <= REWIND_MAX_FRAMES + 10; i++) {
+        memory[PROG_START_ADDR + (i % 64)] = i;
+        rewind_push();
+    }
+    assert(rewind_frames_available() == REWIND_MAX_FRAMES);
+
+    // 2. Pool size bound: every frame rewrites the whole display
+    chip8_init();
+    rewind_init();
+    for (int i = 0; i < REWIND_MAX_FRAMES; i++) {
+        memset(chip8_display, i & 1, DISPLAY_RES_X * DISPLAY_RES_Y);
+        I = i;
+        rewind_push();
+    }
+    available = rewind_frames_available();
+    assert(available < REWIND_MAX_FRAMES);
+    assert(available >= REWIND_POOL_SIZE / ENCODED_MAX_SIZE);
+    while (rewind_step() == 0);
+    assert(I == REWIND_MAX_FRAMES - 1 - available);
+
+    printf("[PASS] test_rewind_bounded\n");
+}
+
+// States pushed by `test_rewind_wrap`, by frame number modulo the ring size
+uint8_t test_frames[REWIND_MAX_FRAMES + 1][CHIP8_SNAPSHOT_SIZE];
+
+// Test: The pool wraps several times with mixed delta sizes, so some laps end
+// before the previous one did (leaving live deltas in the abandoned tail), and
+// every frame in the history is still restored exactly
+void test_rewind_wrap(void) {
+    uint8_t buffer[CHIP8_SNAPSHOT_SIZE];
+    uint32_t seed = 0x12345678;
+    uint32_t pool_used = 0;
+    uint32_t len;
+    uint32_t start;
+    int frame;
+
+    chip8_init();
+    rewind_init();
+    for (frame = 0; pool_used < REWIND_POOL_SIZE * 8; frame++) {
+        // Overwrite a run of 200-8000 bytes of memory and display with xorshift32 values
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        len = 200 + seed % 7800;
+        start = (seed >> 13) % (0x1000 + DISPLAY_RES_X * DISPLAY_RES_Y - len);
+        for (uint32_t i = start; i < start + len; i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            if (i < 0x1000) {
+                memory[i] = seed;
+            } else {
+                chip8_display[i - 0x1000] = seed;
+            }
+        }
+        rewind_push();
+        chip8_snapshot(test_frames[frame % (REWIND_MAX_FRAMES + 1)]);
+        pool_used += len;
+    }
+
+    assert(rewind_frames_available() > 0);
+    for (int i = frame - 2; rewind_step() == 0; i--) {
+        chip8_snapshot(buffer);
+        assert(memcmp(buffer, test_frames[i % (REWIND_MAX_FRAMES + 1)], CHIP8_SNAPSHOT_SIZE) == 0);
+    }
+
+    printf("[PASS] test_rewind_wrap\n");
+}
+
+// Test: A delta with a run past the end of the frame is rejected
+void test_rewind_corrupt(void) {
+    uint8_t frame[CHIP8_SNAPSHOT_SIZE] = {0};
+    uint8_t delta[RLE_HEADER_SIZE + 2] = {0};
+
+    // 1. Valid: skip to the last 2 bytes and flip them
+    delta[0] = (CHIP8_SNAPSHOT_SIZE - 2) & 0xFF;
+    delta[1] = (CHIP8_SNAPSHOT_SIZE - 2) >> 8;
+    delta[2] = 2;
+    delta[4] = delta[5] = 0xFF;
+    assert(apply_delta(frame, delta, sizeof(delta)) == 0);
+    assert(frame[CHIP8_SNAPSHOT_SIZE - 1] == 0xFF);
+
+    // 2. One byte further, past the frame
+    delta[0]++;
+    assert(apply_delta(frame, delta, sizeof(delta)) != 0);
+
+    // 3. A literal longer than the delta itself
+    delta[0]--;
+    delta[2] = 3;
+    assert(apply_delta(frame, delta, sizeof(delta)) != 0);
+
+    printf("[PASS] test_rewind_corrupt\n");
+}
+
+int main(void) {
+    printf("* Running rewind tests\n");
+    test_snapshot_restore();
+    test_rewind_step();
+    test_rewind_bounded();
+    test_rewind_wrap();
+    test_rewind_corrupt();
+
+    printf("\n* All rewind tests passed\n");
+    return 0;
+}
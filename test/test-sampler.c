@@ -0,0 +1,94 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+#include "../src/sampler.c"
+
+void sampler_reset(void) {
+    sampler_head = 0;
+    sampler_tail = 0;
+    sampler_dropped = 0;
+    sampler_total = 0;
+    memset(sampler_addr_counts, 0, sizeof(sampler_addr_counts));
+    memset(sampler_class_counts, 0, sizeof(sampler_class_counts));
+}
+
+// Test: Samples report the instruction executed by `chip8_step`
+void test_chip8_sample(void) {
+    chip8_init();
+    memory[0x200] = 0x13; memory[0x201] = 0x00;
+    memory[0x300] = 0x81; memory[0x301] = 0x24;
+    assert(chip8_sample() == (0x200u << 16 | 0x1300));
+    chip8_step(0, 0);
+    assert(chip8_sample() == (0x200u << 16 | 0x1300));
+    chip8_step(0, 0);
+    assert(chip8_sample() == (0x300u << 16 | 0x8124));
+
+    step_pc = 0xFFF;  // wraps instead of reading past memory
+    memory[0xFFF] = 0x12; memory[0x000] = 0x34;
+    assert(chip8_sample() == (0xFFFu << 16 | 0x1234));
+
+    printf("[PASS] test_chip8_sample\n");
+}
+
+// Test: Buffered samples are counted per address and class, overflow is dropped
+void test_sampler_buffer(void) {
+    chip8_init();
+    sampler_reset();
+    memory[0x200] = 0xD0; memory[0x201] = 0x15;
+
+    // 1. Buffer fills up
+    for (int i = 0; i < SAMPLER_BUFFER_SIZE + 5; i++) {
+        sampler_signal_handler(SIGPROF);
+    }
+    assert(sampler_dropped == 5);
+
+    // 2. Polling empties it
+    sampler_poll();
+    assert(sampler_total == SAMPLER_BUFFER_SIZE);
+    assert(sampler_addr_counts[0x200] == SAMPLER_BUFFER_SIZE);
+    assert(sampler_class_counts[OP_DXYN] == SAMPLER_BUFFER_SIZE);
+
+    // 3. And it is usable again, across the index wrap around
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < SAMPLER_BUFFER_SIZE - 1; i++) {
+            sampler_signal_handler(SIGPROF);
+        }
+        sampler_poll();
+    }
+    assert(sampler_dropped == 5);
+    assert(sampler_total == SAMPLER_BUFFER_SIZE * 4 - 3);
+
+    printf("[PASS] test_sampler_buffer\n");
+}
+
+// Test: The profiling timer delivers samples while emulating
+void test_sampler_timer(void) {
+    chip8_init();
+    sampler_reset();
+    memory[0x200] = 0x12; memory[0x201] = 0x00;  // loop forever
+
+    sampler_init();
+    assert(sampler_start() == 0);
+    for (long i = 0; i < 2000000000L && sampler_head == 0; i++) {
+        chip8_step(0, 0);
+    }
+    sampler_report();
+    assert(sampler_total > 0);
+    assert(sampler_addr_counts[0x200] == sampler_total);
+
+    printf("[PASS] test_sampler_timer\n");
+}
+
+int main(void) {
+    printf("* Running sampler tests\n");
+    test_chip8_sample();
+    test_sampler_buffer();
+    test_sampler_timer();
+
+    printf("\n* All sampler tests passed\n");
+    return 0;
+}
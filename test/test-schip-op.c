@@ -2,6 +2,7 @@
 #include <assert.h>
 
 #include "../src/chip8.c"
+#include "../src/logger.c"
 
 void test_super_chip_init(void) {
     chip8_init();
@@ -197,6 +198,7 @@ void test_00CN_low_res(void) {
     chip8_init();
     low_res_mode = 1;
     chip8_quirk_flag ^= CHIP8_QUIRK_SUPER_LEGACY_SCROLL;
+    chip8_select_quirks();
     chip8_display[0] = 1;  // top left
     chip8_display[DISPLAY_RES_X * (DISPLAY_RES_Y - 1)] = 1;  // bottom left
     memory[PROG_START_ADDR]     = 0x00;
@@ -211,6 +213,7 @@ void test_00CN_low_res(void) {
     chip8_init();
     low_res_mode = 1;
     chip8_quirk_flag |= CHIP8_QUIRK_SUPER_LEGACY_SCROLL;
+    chip8_select_quirks();
     chip8_display[0] = 1;  // top left
     chip8_display[DISPLAY_RES_X * (DISPLAY_RES_Y - 1)] = 1;  // bottom left
     memory[PROG_START_ADDR]     = 0x00;
@@ -230,6 +233,7 @@ void test_00FB_low_res(void) {
     chip8_init();
     low_res_mode = 1;
     chip8_quirk_flag ^= CHIP8_QUIRK_SUPER_LEGACY_SCROLL;
+    chip8_select_quirks();
     chip8_display[0] = 1;
     memory[PROG_START_ADDR]     = 0x00;
     memory[PROG_START_ADDR + 1] = 0xFB;
@@ -248,6 +252,7 @@ void test_00FB_low_res(void) {
     chip8_init();
     low_res_mode = 1;
     chip8_quirk_flag |= CHIP8_QUIRK_SUPER_LEGACY_SCROLL;
+    chip8_select_quirks();
     chip8_display[0] = 1;
     memory[PROG_START_ADDR]     = 0x00;
     memory[PROG_START_ADDR + 1] = 0xFB;
@@ -271,6 +276,7 @@ void test_00FC_low_res(void) {
     chip8_init();
     low_res_mode = 1;
     chip8_quirk_flag ^= CHIP8_QUIRK_SUPER_LEGACY_SCROLL;
+    chip8_select_quirks();
     chip8_display[DISPLAY_RES_X - 1] = 1;
     memory[PROG_START_ADDR]     = 0x00;
     memory[PROG_START_ADDR + 1] = 0xFC;
@@ -289,6 +295,7 @@ void test_00FC_low_res(void) {
     chip8_init();
     low_res_mode = 1;
     chip8_quirk_flag |= CHIP8_QUIRK_SUPER_LEGACY_SCROLL;
+    chip8_select_quirks();
     chip8_display[DISPLAY_RES_X - 1] = 1;
     memory[PROG_START_ADDR]     = 0x00;
     memory[PROG_START_ADDR + 1] = 0xFC;
@@ -377,6 +384,85 @@ void test_00FF(void) {
     printf("[PASS] test_00FF\n");
 }
 
+// Set up a DXY0 draw of a 16x16 sprite with all pixels on, at VX = x, VY = y
+void setup_DXY0(uint8_t low_res, uint8_t x, uint8_t y) {
+    chip8_init();
+    low_res_mode = low_res;
+    I = 0x300;
+    memset(&memory[0x300], 0xFF, 32);
+    V[0x1] = x;
+    V[0x2] = y;
+    memory[PROG_START_ADDR]     = 0xD1;
+    memory[PROG_START_ADDR + 1] = 0x20;
+}
+
+// Test: 16x16 sprites (SUPER-CHIP 1.1)
+void test_DXY0(void) {
+    // 1. high res, drawn then erased with every row colliding
+    setup_DXY0(0, 0, 0);
+    memory[0x301] = 0x7F;  // row 0: leftmost pixel of the 2nd byte off
+    chip8_step(0, 0.0);
+    assert(V[0xF] == 0);
+    assert(chip8_display[0] == 1);
+    assert(chip8_display[7] == 1);
+    assert(chip8_display[8] == 0);
+    assert(chip8_display[15] == 1);
+    assert(chip8_display[16] == 0);
+    assert(chip8_display[15 * DISPLAY_RES_X + 15] == 1);
+    assert(chip8_display[16 * DISPLAY_RES_X] == 0);
+    pc = PROG_START_ADDR;
+    chip8_step(0, 0.0);
+    assert(V[0xF] == 16);
+    assert(chip8_display[0] == 0);
+    assert(chip8_display[8] == 0);
+
+    // 2. high res, VF counts rows with a collision, not pixels
+    setup_DXY0(0, 0, 0);
+    chip8_display[3 * DISPLAY_RES_X + 5] = 1;
+    chip8_display[3 * DISPLAY_RES_X + 6] = 1;
+    chip8_display[7 * DISPLAY_RES_X + 0] = 1;
+    chip8_step(0, 0.0);
+    assert(V[0xF] == 2);
+    assert(chip8_display[3 * DISPLAY_RES_X + 5] == 0);
+
+    // 3. high res, clipped at the right and bottom edges rather than wrapped
+    setup_DXY0(0, DISPLAY_RES_X - 4, DISPLAY_RES_Y - 2);
+    chip8_step(0, 0.0);
+    assert(chip8_display[(DISPLAY_RES_Y - 2) * DISPLAY_RES_X + DISPLAY_RES_X - 4] == 1);
+    assert(chip8_display[DISPLAY_RES_X * DISPLAY_RES_Y - 1] == 1);
+    assert(chip8_display[(DISPLAY_RES_Y - 1) * DISPLAY_RES_X] == 0);  // no wrap to the left
+    for (int i = 0; i < DISPLAY_RES_X * 14; i++) {
+        assert(chip8_display[i] == 0);  // no wrap to the top
+    }
+
+    // 4. high res, the start position wraps
+    setup_DXY0(0, DISPLAY_RES_X + 2, DISPLAY_RES_Y + 1);
+    chip8_step(0, 0.0);
+    assert(chip8_display[DISPLAY_RES_X + 2] == 1);
+    assert(chip8_display[DISPLAY_RES_X + 1] == 0);
+
+    // 5. low res, pixels doubled and VF set to 0/1
+    setup_DXY0(1, 0, 0);
+    chip8_display[0] = 1;
+    chip8_display[1] = 1;
+    chip8_display[DISPLAY_RES_X] = 1;
+    chip8_display[DISPLAY_RES_X + 1] = 1;
+    chip8_display[2 * DISPLAY_RES_X * 5] = 1;
+    chip8_display[2 * DISPLAY_RES_X * 5 + 1] = 1;
+    chip8_display[2 * DISPLAY_RES_X * 5 + DISPLAY_RES_X] = 1;
+    chip8_display[2 * DISPLAY_RES_X * 5 + DISPLAY_RES_X + 1] = 1;
+    chip8_step(0, 0.0);
+    assert(V[0xF] == 1);
+    assert(chip8_display[0] == 0);
+    assert(chip8_display[DISPLAY_RES_X + 1] == 0);
+    assert(chip8_display[31] == 1);
+    assert(chip8_display[32] == 0);
+    assert(chip8_display[31 * DISPLAY_RES_X + 31] == 1);
+    assert(chip8_display[32 * DISPLAY_RES_X] == 0);
+
+    printf("[PASS] test_DXY0\n");
+}
+
 // Test: VF set to 0/1 (low res) or count of on bits flipped off (high res)
 void test_DXYN_VF(void) {
     // 1. low res w/ all pixels off
@@ -424,33 +510,46 @@ void test_DXYN_VF(void) {
     printf("[PASS] test_DXYN_VF\n");
 }
 
-// Test: Dump VX register values (up to and including V7)
+// Test: Dump VX register values (up to and including V7) to the in memory RPL flags
 void test_FX75(void) {
+    char file_name[SUPER_CHIP_RPL_FILE_LEN];
     FILE *f;
     uint8_t file_bytes;
-    uint8_t read_byte;
+    uint8_t read_bytes[NUM_RPL_FLAGS];
 
-    // 1. Write one register (V0)
+    // 1. Write one register (V0). Nothing is written to file until flushed
     chip8_init();
+    rpl_flags_file_name(file_name);
+    remove(file_name);
     V[0x0] = 5;
     memory[PROG_START_ADDR]     = 0xF0;
     memory[PROG_START_ADDR + 1] = 0x75;
     chip8_step(0, 0.0);
-    f = fopen(SUPER_CHIP_RPL_FILE, "rb");
+    assert(rpl_flags[0] == 5);
+    assert(rpl_flags[1] == 0);
+    assert(rpl_flags_dirty == 1);
+    assert(!fopen(file_name, "rb"));
+
+    chip8_flush_rpl_flags();
+    assert(rpl_flags_dirty == 0);
+    f = fopen(file_name, "rb");
     assert(f);
-    
+
     // Determine file size
     fseek(f, 0, SEEK_END);
     file_bytes = ftell(f);
     fseek(f, 0, SEEK_SET);
-    assert(file_bytes == 1);
+    assert(file_bytes == NUM_RPL_FLAGS);
 
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 5);
+    assert(fread(read_bytes, sizeof(uint8_t), NUM_RPL_FLAGS, f) == NUM_RPL_FLAGS);
+    assert(read_bytes[0] == 5);
+    assert(read_bytes[1] == 0);
     fclose(f);
-    
-    // 2. Write four registers (and implicitly clear the file)
+
+    // 2. Write four registers. Flags above V4 are kept
     chip8_init();
+    rpl_flags[5] = 0xEE;
+    rpl_flags_loaded = 1;
     V[0x0] = 6;
     V[0x1] = 7;
     V[0x2] = 8;
@@ -460,29 +559,16 @@ void test_FX75(void) {
     memory[PROG_START_ADDR]     = 0xF4;
     memory[PROG_START_ADDR + 1] = 0x75;
     chip8_step(0, 0.0);
-    f = fopen(SUPER_CHIP_RPL_FILE, "rb");
-    assert(f);
-    
-    // Determine file size
-    fseek(f, 0, SEEK_END);
-    file_bytes = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    assert(file_bytes == 5);
-
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 6);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 7);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 8);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 9);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 0xA);
-    fclose(f);
-    
-    // 3. Limit writing to V7 (and implicitly clear the file)
+    assert(rpl_flags[0] == 6);
+    assert(rpl_flags[1] == 7);
+    assert(rpl_flags[2] == 8);
+    assert(rpl_flags[3] == 9);
+    assert(rpl_flags[4] == 0xA);
+    assert(rpl_flags[5] == 0xEE);
+
+    // 3. Limit writing to V7
     chip8_init();
+    rpl_flags_loaded = 1;
     V[0x0] = 6;
     V[0x1] = 7;
     V[0x2] = 8;
@@ -495,89 +581,45 @@ void test_FX75(void) {
     memory[PROG_START_ADDR]     = 0xF8;  // 8 > 7 (limit)
     memory[PROG_START_ADDR + 1] = 0x75;
     chip8_step(0, 0.0);
-    f = fopen(SUPER_CHIP_RPL_FILE, "rb");
-    assert(f);
-    
-    // Determine file size
-    fseek(f, 0, SEEK_END);
-    file_bytes = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    assert(file_bytes == 8);
-
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 6);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 7);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 8);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 9);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 0xA);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 0xB);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 0xC);
-    assert(fread(&read_byte, sizeof(uint8_t), 1, f) == 1);
-    assert(read_byte == 0xD);
-    fclose(f);
+    assert(rpl_flags[0] == 6);
+    assert(rpl_flags[1] == 7);
+    assert(rpl_flags[2] == 8);
+    assert(rpl_flags[3] == 9);
+    assert(rpl_flags[4] == 0xA);
+    assert(rpl_flags[5] == 0xB);
+    assert(rpl_flags[6] == 0xC);
+    assert(rpl_flags[7] == 0xD);
+
+    // 4. Flags are stored per ROM
+    chip8_init();
+    rom_hash = 0x12345678;
+    rpl_flags_file_name(file_name);
+    assert(strcmp(file_name, "rpl-flags-12345678.bin") == 0);
 
     printf("[PASS] test_FX75\n");
 }
 
-// Test: Load register values (up to and including V7)
+// Test: Load register values (up to and including V7) from the RPL flags
 void test_FX85(void) {
+    char file_name[SUPER_CHIP_RPL_FILE_LEN];
     FILE *f;
-    uint8_t byte_to_write;
-
-    // 1. Load one register (V0)
-    f = fopen(SUPER_CHIP_RPL_FILE, "w");
-    byte_to_write = 100;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    fclose(f);
+    uint8_t bytes_to_write[] = {10, 11, 12, 13, 14};
 
+    // 1. Missing file loads cleared flags
     chip8_init();
+    rpl_flags_file_name(file_name);
+    remove(file_name);
     V[0x0] = 5;
     V[0x1] = 5;
     memory[PROG_START_ADDR]     = 0xF0;
     memory[PROG_START_ADDR + 1] = 0x85;
     chip8_step(0, 0.0);
-    assert(V[0x0] == 100);
+    assert(V[0x0] == 0);
     assert(V[0x1] == 5);  // unchanged
-    
-    // 2. Load four registers
-    f = fopen(SUPER_CHIP_RPL_FILE, "w");
-    byte_to_write = 0;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    byte_to_write = 1;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    byte_to_write = 2;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    byte_to_write = 3;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    fclose(f);
 
-    chip8_init();
-    memory[PROG_START_ADDR]     = 0xF3;
-    memory[PROG_START_ADDR + 1] = 0x85;
-    chip8_step(0, 0.0);
-    assert(V[0x0] == 0);
-    assert(V[0x1] == 1);
-    assert(V[0x2] == 2);
-    assert(V[0x3] == 3);
-    
-    // 3. Load less than present in file
-    f = fopen(SUPER_CHIP_RPL_FILE, "w");
-    byte_to_write = 10;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    byte_to_write = 11;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    byte_to_write = 12;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    byte_to_write = 13;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
-    byte_to_write = 14;
-    fwrite(&byte_to_write, sizeof(uint8_t), 1, f);
+    // 2. Load less than present in file
+    f = fopen(file_name, "wb");
+    fwrite(bytes_to_write, sizeof(uint8_t), sizeof(bytes_to_write), f);
     fclose(f);
 
     chip8_init();
@@ -590,6 +632,31 @@ void test_FX85(void) {
     assert(V[0x3] == 0);
     assert(V[0x4] == 0);
 
+    // 3. The file is only read once
+    remove(file_name);
+    V[0x0] = 0;
+    memory[PROG_START_ADDR + 2] = 0xF0;
+    memory[PROG_START_ADDR + 3] = 0x85;
+    chip8_step(0, 0.0);
+    assert(V[0x0] == 10);
+
+    // 4. Load up to V7 of what was stored by FX75
+    chip8_init();
+    for (int i = 0; i < NUM_GP_REGISTERS; i++) {
+        V[i] = i + 1;
+    }
+    memory[PROG_START_ADDR]     = 0xFF;
+    memory[PROG_START_ADDR + 1] = 0x75;
+    memory[PROG_START_ADDR + 2] = 0xFF;
+    memory[PROG_START_ADDR + 3] = 0x85;
+    chip8_step(0, 0.0);
+    memset(V, 0, NUM_GP_REGISTERS);
+    chip8_step(0, 0.0);
+    for (int i = 0; i < NUM_RPL_FLAGS; i++) {
+        assert(V[i] == i + 1);
+    }
+    assert(V[NUM_RPL_FLAGS] == 0);
+
     printf("[PASS] test_FX85\n");
 }
 
@@ -607,10 +674,10 @@ int main(void) {
     test_00FD();  // Exit interpreter
     test_00FE();  // Switch to low res mode/disable high res mode
     test_00FF();  // Switch to high res mode/enable high res mode
-    // test_DXY0();  // TODO: Understand 16x16 sprite usage
+    test_DXY0();  // Draw a 16x16 sprite
     test_DXYN_VF();  // Test low & high res VF setting behaviour
-    test_FX75();  // Write/dump V0..VX (up to 7, inclusive) values to file
-    test_FX85();  // Read/load V0..VX (up to 7, inclusive) values from file
+    test_FX75();  // Write/dump V0..VX (up to 7, inclusive) values to RPL flags
+    test_FX85();  // Read/load V0..VX (up to 7, inclusive) values from RPL flags
 
     printf("\n* All SUPER-CHIP op tests passed\n");
     return 0;
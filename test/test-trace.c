@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <assert.h>
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+#include "../src/trace.c"
+
+#define TEST_TRACE_FILE_NAME "test-trace.bin"
+#define TEST_RECORDS 100000  // several full 64 KB buffers
+
+struct chip8_trace_record test_records[TEST_RECORDS];
+struct trace_reader test_reader;
+
+// Encode `n` records to the test trace
+void write_records(const struct chip8_trace_record *records, uint32_t n) {
+    assert(trace_open(TEST_TRACE_FILE_NAME) == 0);
+    for (uint32_t i = 0; i < n; i++) {
+        trace_record(&records[i]);
+    }
+    trace_close();
+}
+
+// Decode the test trace, checking it against `records`
+void check_records(const struct chip8_trace_record *records, uint32_t n) {
+    struct chip8_trace_record record;
+
+    assert(trace_reader_open(&test_reader, TEST_TRACE_FILE_NAME) == 0);
+    for (uint32_t i = 0; i < n; i++) {
+        assert(trace_reader_next(&test_reader, &record));
+        assert(record.cycle == records[i].cycle);
+        assert(record.pc == records[i].pc);
+        assert(record.instruction == records[i].instruction);
+        assert(record.I == records[i].I);
+        assert(record.reg == records[i].reg);
+        assert(record.value == (records[i].reg == CHIP8_TRACE_NO_REG ? 0 : records[i].value));
+    }
+    assert(trace_reader_next(&test_reader, &record) == 0);
+    trace_reader_close(&test_reader);
+}
+
+// Test: Each field is predicted when it can be, and sent when it cannot
+void test_trace_fields(void) {
+    struct chip8_trace_record records[] = {
+        {0, 0x200, 0x6001, 0x000, 0x0, 0x01},              // first record
+        {1, 0x202, 0xA300, 0x300, CHIP8_TRACE_NO_REG, 0},  // all predicted but the new I
+        {1001, 0x204, 0x7105, 0x300, 0x1, 0x05},           // cycle gap, register change
+        {1002, 0x200, 0x6001, 0x300, 0x0, 0x01},           // non-sequential pc, op already seen
+        {1003, 0x202, 0xA400, 0x400, CHIP8_TRACE_NO_REG, 0},  // op changed at the same pc
+        {1004 + (1ULL << 40), 0x204, 0x7105, 0x400, 0xF, 0xFF},  // multi-byte cycle varint
+        {1005 + (1ULL << 40), 0xFFE, 0x1FFE, 0x400, CHIP8_TRACE_NO_REG, 0},
+    };
+
+    write_records(records, sizeof(records) / sizeof(records[0]));
+    check_records(records, sizeof(records) / sizeof(records[0]));
+
+    printf("[PASS] test_trace_fields\n");
+}
+
+// Test: Mixed records round trip across many 64 KB buffer handoffs
+void test_trace_buffers(void) {
+    uint32_t seed = 0x2545F491;
+    uint64_t cycle = 0;
+    uint16_t pc = PROG_START_ADDR;
+    uint16_t I_value = 0;
+
+    for (uint32_t i = 0; i < TEST_RECORDS; i++) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        cycle += (seed & 0x70) ? 1 : 1 + (seed >> 8) % 100000u;
+        pc = (seed & 0x0C) ? (uint16_t) (pc + 2) : (seed >> 4) & 0xFFE;
+        I_value = (seed & 0x300) ? I_value : seed >> 20;
+        test_records[i].cycle = cycle;
+        test_records[i].pc = pc;
+        test_records[i].instruction = (seed & 0x3000) ? pc ^ 0x5A5A : seed >> 16;
+        test_records[i].I = I_value;
+        test_records[i].reg = (seed & 0x8000) ? CHIP8_TRACE_NO_REG : (seed >> 24) & 0xF;
+        test_records[i].value = seed >> 12;
+    }
+    write_records(test_records, TEST_RECORDS);
+    check_records(test_records, TEST_RECORDS);
+
+    printf("[PASS] test_trace_buffers\n");
+}
+
+// Test: Records reported by `chip8_step` through `chip8_trace_hook`
+void test_trace_hook(void) {
+    uint8_t program[] = {
+        0x60, 0x07,  // 200: LD V0, 07
+        0xA3, 0x00,  // 202: LD I, 300
+        0x70, 0x00,  // 204: ADD V0, 00  (no register change)
+        0x12, 0x00,  // 206: JP 200
+    };
+    struct chip8_trace_record expected[] = {
+        {0, 0x200, 0x6007, 0x000, 0x0, 0x07},
+        {1, 0x202, 0xA300, 0x300, CHIP8_TRACE_NO_REG, 0},
+        {2, 0x204, 0x7000, 0x300, CHIP8_TRACE_NO_REG, 0},
+        {3, 0x206, 0x1200, 0x300, CHIP8_TRACE_NO_REG, 0},
+        {4, 0x200, 0x6007, 0x300, CHIP8_TRACE_NO_REG, 0},  // V0 already 07
+    };
+
+    chip8_init();
+    memcpy(&memory[PROG_START_ADDR], program, sizeof(program));
+    assert(trace_open(TEST_TRACE_FILE_NAME) == 0);
+    chip8_trace_hook = &trace_record;
+    for (uint32_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        chip8_step(0, 0.0);
+    }
+    chip8_trace_hook = NULL;
+    trace_close();
+    check_records(expected, sizeof(expected) / sizeof(expected[0]));
+
+    printf("[PASS] test_trace_hook\n");
+}
+
+// Write the test trace from raw bytes after a valid header
+void write_raw(const uint8_t *data, uint32_t len) {
+    uint8_t header[TRACE_HEADER_SIZE] = {0};
+    FILE *f = fopen(TEST_TRACE_FILE_NAME, "wb");
+
+    assert(f);
+    memcpy(header, TRACE_MAGIC, 4);
+    header[4] = TRACE_VERSION;
+    fwrite(header, 1, TRACE_HEADER_SIZE, f);
+    fwrite(data, 1, len, f);
+    fclose(f);
+}
+
+// Test: A trace cut short or corrupt ends the records rather than reading past them
+void test_trace_truncated(void) {
+    struct chip8_trace_record record;
+    uint8_t data[TRACE_READER_BUFFER_SIZE];
+    uint32_t len;
+    FILE *f;
+
+    // 1. Cuts at many lengths (of records from `test_trace_buffers`): the whole
+    // records before the cut are read
+    write_records(test_records, 1000);
+    f = fopen(TEST_TRACE_FILE_NAME, "rb");
+    fseek(f, TRACE_HEADER_SIZE, SEEK_SET);
+    len = fread(data, 1, sizeof(data), f);
+    fclose(f);
+    for (uint32_t cut = 1; cut <= len; cut += cut < 64 ? 1 : 997) {
+        write_raw(data, len - cut);
+        assert(trace_reader_open(&test_reader, TEST_TRACE_FILE_NAME) == 0);
+        for (uint32_t i = 0; trace_reader_next(&test_reader, &record); i++) {
+            assert(i < 1000 && record.cycle == test_records[i].cycle && record.pc == test_records[i].pc);
+        }
+        assert(test_reader.pos <= test_reader.len);
+        trace_reader_close(&test_reader);
+    }
+
+    // 2. Only a flags byte with every field
+    data[0] = 0x1F;
+    write_raw(data, 1);
+    assert(trace_reader_open(&test_reader, TEST_TRACE_FILE_NAME) == 0);
+    assert(trace_reader_next(&test_reader, &record) == 0);
+    trace_reader_close(&test_reader);
+
+    // 3. A cycle varint longer than 10 bytes
+    data[0] = TRACE_FLAG_CYCLE;
+    memset(&data[1], 0xFF, 16);
+    data[17] = 0;
+    write_raw(data, 18);
+    assert(trace_reader_open(&test_reader, TEST_TRACE_FILE_NAME) == 0);
+    assert(trace_reader_next(&test_reader, &record) == 0);
+    trace_reader_close(&test_reader);
+
+    printf("[PASS] test_trace_truncated\n");
+}
+
+int main(void) {
+    printf("* Running trace tests\n");
+    test_trace_fields();
+    test_trace_buffers();
+    test_trace_hook();
+    test_trace_truncated();
+
+    remove(TEST_TRACE_FILE_NAME);
+    printf("\n* All trace tests passed\n");
+    return 0;
+}
@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/chip8.c"
+#include "../src/logger.c"
+
+/*
+ * Run a ROM headless and print the display hash of every frame that
+ * changed, for golden frame regression checks.
+ * 
+ * Usage: ch8-frame-hash rom_path [frames]
+ * 
+ * Time is derived from the instruction count (700 instructions and 60
+ * frames per emulated second, as `ch8` paces them) with no key input, so
+ * the output only depends on the ROM and the emulator. SUPER-CHIP RPL
+ * flags start cleared rather than loaded from a persisted flags file.
+ * Each line is `frame hash`, e.g. store a known good run and diff later
+ * runs with it:
+ * 
+ *   ./ch8-frame-hash roms/test_opcode.ch8 120 > golden.txt
+ *   ./ch8-frame-hash roms/test_opcode.ch8 120 | diff golden.txt -
+ */
+
+#define CPU_HZ 700
+#define DISPLAY_HZ 60
+#define DEFAULT_FRAMES 600
+
+int main(int argc, char *argv[]) {
+    uint32_t frames = DEFAULT_FRAMES;
+    uint64_t hash;
+    uint64_t last_hash;
+
+    if (argc < 2 || argc > 3) {
+        printf("Usage: %s rom_path [frames]\n", argv[0]);
+        return -1;
+    }
+    if (argc == 3) {
+        frames = atoi(argv[2]);
+    }
+
+    chip8_init();
+    chip8_load_rom(argv[1]);
+    // Start with cleared RPL flags instead of reading `rpl-flags-<hash>.bin`
+    // from the current directory on the first FX75/FX85 (never flushed back)
+    rpl_flags_loaded = 1;
+    chip8_next_timer_update = 0;
+    last_hash = chip8_display_hash(chip8_display);
+
+    for (uint32_t frame = 1; frame <= frames && !chip8_exit_flag; frame++) {
+        // Instructions up to the end of this frame
+        while (chip8_cycles * DISPLAY_HZ < (uint64_t) frame * CPU_HZ && !chip8_exit_flag) {
+            chip8_step(0, (double) chip8_cycles / CPU_HZ);
+        }
+        if (chip8_display_updated) {
+            chip8_display_updated = 0;
+            hash = chip8_display_hash(chip8_display);
+            if (hash != last_hash) {
+                printf("%u %016llx\n", frame, (unsigned long long) hash);
+                last_hash = hash;
+            }
+        }
+    }
+    return 0;
+}
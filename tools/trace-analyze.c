@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../src/trace.c"
+
+/*
+ * Offline analysis of a trace written with `ch8 rom_path -trace`.
+ * 
+ * Usage: ch8-trace-analyze [trace_path]
+ * 
+ * The trace is streamed one record at a time, and all statistics are
+ * kept per address of the 4 KB address space, so memory use does not
+ * depend on the length of the trace.
+ */
+
+#define ADDR_MASK (TRACE_ADDR_SPACE - 1)
+#define TOP_N 10
+#define MAX_SMC_EVENTS 16
+
+#define EDGE_TABLE_SIZE 4096  // power of two
+#define EDGE_EMPTY 0xFFFFFFFF
+
+#define HEATMAP_CELL 16   // bytes per heatmap character
+#define HEATMAP_ROW 0x100 // bytes per heatmap row
+
+struct block {
+    uint16_t start;
+    uint16_t end;  // address of the last instruction
+    uint64_t entries;
+    uint64_t instructions;
+};
+
+struct back_edge {
+    uint32_t key;  // from << 12 | to, or EDGE_EMPTY
+    uint64_t count;
+};
+
+struct smc_event {
+    uint64_t cycle;
+    uint16_t writer_pc;
+    uint16_t addr;
+};
+
+uint64_t exec_counts[TRACE_ADDR_SPACE];
+uint64_t read_counts[TRACE_ADDR_SPACE];
+uint64_t write_counts[TRACE_ADDR_SPACE];
+uint8_t  leaders[TRACE_ADDR_SPACE];   // block starts
+uint8_t  executed[TRACE_ADDR_SPACE];
+uint8_t  written[TRACE_ADDR_SPACE];
+
+struct back_edge back_edges[EDGE_TABLE_SIZE];
+uint32_t dropped_edges;
+
+struct smc_event smc_events[MAX_SMC_EVENTS];
+uint64_t smc_count;
+uint32_t generated_count;
+
+// Control flow: jumps, calls, returns and skips end a basic block
+uint8_t is_branch(uint16_t instruction) {
+    switch (instruction >> 12) {
+        case 0x0: return instruction == 0x00EE;
+        case 0x1:
+        case 0x2:
+        case 0x3:
+        case 0x4:
+        case 0x5:
+        case 0x9:
+        case 0xB:
+        case 0xE:
+            return 1;
+        case 0xF: return (instruction & 0xFF) == 0x0A;  // blocking key wait re-executes itself
+    }
+    return 0;
+}
+
+void count_back_edge(uint16_t from, uint16_t to) {
+    uint32_t key = from << 12 | to;
+    uint32_t i = (key * 2654435761u) & (EDGE_TABLE_SIZE - 1);
+
+    for (uint32_t probe = 0; probe < EDGE_TABLE_SIZE; probe++) {
+        if (back_edges[i].key == key) {
+            back_edges[i].count++;
+            return;
+        }
+        if (back_edges[i].key == EDGE_EMPTY) {
+            back_edges[i].key = key;
+            back_edges[i].count = 1;
+            return;
+        }
+        i = (i + 1) & (EDGE_TABLE_SIZE - 1);
+    }
+    dropped_edges++;
+}
+
+void memory_write(const struct chip8_trace_record *record, uint16_t addr) {
+    addr &= ADDR_MASK;
+    write_counts[addr]++;
+    written[addr] = 1;
+    if (executed[addr]) {
+        if (smc_count < MAX_SMC_EVENTS) {
+            smc_events[smc_count].cycle = record->cycle;
+            smc_events[smc_count].writer_pc = record->pc;
+            smc_events[smc_count].addr = addr;
+        }
+        smc_count++;
+    }
+}
+
+// Memory accessed relative to I, where `I` is the value before execution
+void count_memory_access(const struct chip8_trace_record *record, uint16_t I) {
+    uint8_t X = (record->instruction & 0x0F00) >> 8;
+    uint8_t N = record->instruction & 0x000F;
+
+    switch (record->instruction >> 12) {
+        case 0xD:
+            // DXY0 is a 16x16 sprite: 32 bytes
+            for (int i = 0; i < (N ? N : 32); i++) {
+                read_counts[(I + i) & ADDR_MASK]++;
+            }
+            break;
+        case 0xF:
+            switch (record->instruction & 0xFF) {
+                case 0x33:
+                    for (int i = 0; i < 3; i++) {
+                        memory_write(record, I + i);
+                    }
+                    break;
+                case 0x55:
+                    for (int i = 0; i <= X; i++) {
+                        memory_write(record, I + i);
+                    }
+                    break;
+                case 0x65:
+                    for (int i = 0; i <= X; i++) {
+                        read_counts[(I + i) & ADDR_MASK]++;
+                    }
+                    break;
+            }
+            break;
+    }
+}
+
+int compare_blocks(const void *a, const void *b) {
+    const struct block *x = a;
+    const struct block *y = b;
+    return (x->instructions < y->instructions) - (x->instructions > y->instructions);
+}
+
+int compare_back_edges(const void *a, const void *b) {
+    const struct back_edge *x = a;
+    const struct back_edge *y = b;
+    return (x->count < y->count) - (x->count > y->count);
+}
+
+void print_blocks(uint64_t total) {
+    static struct block blocks[TRACE_ADDR_SPACE];
+    uint32_t n_blocks = 0;
+    struct block *b = NULL;
+
+    // Blocks run from a leader until the next leader or unexecuted address
+    for (uint32_t addr = 0; addr < TRACE_ADDR_SPACE; addr++) {
+        if (!exec_counts[addr]) {
+            b = NULL;
+            continue;
+        }
+        if (!b || leaders[addr]) {
+            b = &blocks[n_blocks++];
+            b->start = addr;
+            b->entries = exec_counts[addr];
+            b->instructions = 0;
+        }
+        b->end = addr;
+        b->instructions += exec_counts[addr];
+    }
+    qsort(blocks, n_blocks, sizeof(struct block), compare_blocks);
+
+    printf("\n* Hottest basic blocks (%u total)\n", n_blocks);
+    printf("start  end      entries   instructions   %%total\n");
+    for (uint32_t i = 0; i < n_blocks && i < TOP_N; i++) {
+        printf("%03x    %03x %12llu %14llu  %6.2f%%\n", blocks[i].start, blocks[i].end,
+            (unsigned long long) blocks[i].entries, (unsigned long long) blocks[i].instructions,
+            100.0 * blocks[i].instructions / total);
+    }
+}
+
+void print_loops(uint64_t total) {
+    uint32_t n_edges = 0;
+    uint64_t instructions;
+    uint16_t from;
+    uint16_t to;
+
+    // Compact used entries to the front for sorting
+    for (uint32_t i = 0; i < EDGE_TABLE_SIZE; i++) {
+        if (back_edges[i].key != EDGE_EMPTY) {
+            back_edges[n_edges++] = back_edges[i];
+        }
+    }
+    qsort(back_edges, n_edges, sizeof(struct back_edge), compare_back_edges);
+
+    printf("\n* Hottest loops (backward jumps, %u total)\n", n_edges);
+    printf("head   latch   iterations   instructions   %%total\n");
+    for (uint32_t i = 0; i < n_edges && i < TOP_N; i++) {
+        from = back_edges[i].key >> 12;
+        to = back_edges[i].key & ADDR_MASK;
+        instructions = 0;
+        for (uint16_t addr = to; addr <= from; addr++) {
+            instructions += exec_counts[addr];
+        }
+        printf("%03x    %03x %12llu %14llu  %6.2f%%\n", to, from,
+            (unsigned long long) back_edges[i].count, (unsigned long long) instructions,
+            100.0 * instructions / total);
+    }
+    if (dropped_edges) {
+        printf("(%u backward jumps not counted, edge table full)\n", dropped_edges);
+    }
+}
+
+// One character per HEATMAP_CELL bytes, scaled to the hottest cell
+void print_heatmap(const char *title, const uint64_t *counts) {
+    const char *shades = " .:-=+*#%@";
+    uint64_t cells[TRACE_ADDR_SPACE / HEATMAP_CELL] = {0};
+    uint64_t max = 0;
+    uint64_t total = 0;
+    int shade;
+
+    for (uint32_t addr = 0; addr < TRACE_ADDR_SPACE; addr++) {
+        cells[addr / HEATMAP_CELL] += counts[addr];
+        total += counts[addr];
+    }
+    for (uint32_t i = 0; i < TRACE_ADDR_SPACE / HEATMAP_CELL; i++) {
+        max = cells[i] > max ? cells[i] : max;
+    }
+
+    printf("\n* %s heatmap (%llu bytes, %d bytes per cell)\n", title, (unsigned long long) total, HEATMAP_CELL);
+    if (!total) {
+        return;
+    }
+    for (uint32_t row = 0; row < TRACE_ADDR_SPACE; row += HEATMAP_ROW) {
+        printf("%03x |", row);
+        for (uint32_t cell = row / HEATMAP_CELL; cell < (row + HEATMAP_ROW) / HEATMAP_CELL; cell++) {
+            shade = cells[cell] ? 1 + (int) (8 * cells[cell] / max) : 0;
+            putchar(shades[shade]);
+        }
+        printf("|\n");
+    }
+}
+
+void print_self_modifying(void) {
+    uint32_t n_addrs = 0;
+
+    for (uint32_t addr = 0; addr < TRACE_ADDR_SPACE; addr++) {
+        n_addrs += written[addr] && executed[addr];
+    }
+    printf("\n* Self-modifying code: %u addresses both written and executed\n", n_addrs);
+    printf("%u first executed after being written, %llu writes to already executed code\n",
+        generated_count, (unsigned long long) smc_count);
+    for (uint64_t i = 0; i < smc_count && i < MAX_SMC_EVENTS; i++) {
+        printf("cycle %llu: %03x wrote %03x\n", (unsigned long long) smc_events[i].cycle,
+            smc_events[i].writer_pc, smc_events[i].addr);
+    }
+    if (smc_count > MAX_SMC_EVENTS) {
+        printf("...\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    static struct trace_reader reader;
+    struct chip8_trace_record record;
+    struct chip8_trace_record last;
+    uint64_t total = 0;
+    uint16_t addr;
+    uint16_t I = 0;
+
+    if (argc > 2) {
+        printf("Usage: %s [trace_path]\n", argv[0]);
+        return -1;
+    }
+    if (trace_reader_open(&reader, argc == 2 ? argv[1] : TRACE_FILE_NAME) != 0) {
+        return -1;
+    }
+    memset(back_edges, 0xFF, sizeof(back_edges));
+
+    last.pc = TRACE_INITIAL_PC;
+    last.instruction = 0;
+    while (trace_reader_next(&reader, &record)) {
+        addr = record.pc & ADDR_MASK;
+
+        // Block boundaries: after control flow, and at any non-sequential target
+        if (total == 0 || record.pc != (uint16_t) (last.pc + 2) || is_branch(last.instruction)) {
+            leaders[addr] = 1;
+            // Returns also go backwards but are not loops
+            if (total && record.pc <= last.pc && ((last.instruction >> 12) == 0x1 || (last.instruction >> 12) == 0xB)) {
+                count_back_edge(last.pc & ADDR_MASK, addr);
+            }
+        }
+        exec_counts[addr]++;
+        executed[addr] = 1;
+        if (written[addr] && exec_counts[addr] == 1) {
+            // Code written before it first ran, e.g. generated code
+            generated_count++;
+        }
+
+        count_memory_access(&record, I);
+        I = record.I;
+        last = record;
+        total++;
+    }
+    trace_reader_close(&reader);
+
+    printf("* %llu instructions traced\n", (unsigned long long) total);
+    if (!total) {
+        return 0;
+    }
+    print_blocks(total);
+    print_loops(total);
+    print_heatmap("Memory read (DXYN, FX65)", read_counts);
+    print_heatmap("Memory write (FX33, FX55)", write_counts);
+    print_self_modifying();
+    return 0;
+}